@@ -34,6 +34,74 @@
 #define PIN_INPUT     1
 #define PIN_OUTPUT    0
 
+#define ADC_TRIGGER_NONE            0x00    //ADCON2 TRIGSEL = no auto-conversion trigger
+#define ADC_TRIGGER_TIMER2_MATCH    0x50    //ADCON2 TRIGSEL = Timer2 match to PR2 (the PWM period)
+
+#define ADC_STREAM_BUFFER_MASK  (ADC_STREAM_BUFFER_SIZE - 1)
+
+#define ADC_TIMER1_FOSC_4       0x01    //T1CON: TMR1CS = Fosc/4, 1:1 prescale, TMR1ON (as usb_profile.c)
+#define ADC_CONVERSION_CYCLES   184     //11.5 TAD at Fosc/64 (ADCON1 = 0xE3), trigger to ADIF
+#define ADC_STREAM_LATE_MARGIN  32      //cycles the conversion may end early or the reference be off
+
+#define ADC_ACQUISITION_CYCLES              60      //5us at 12 MIPS after switching between pins
+#define ADC_TEMPERATURE_ACQUISITION_CYCLES  2400    //200us at 12 MIPS for the temperature indicator
+
+//Each ring entry carries the number of results dropped just before it in
+//the bits above the (10 + oversample) bit result, so the reader can keep the
+//sample index across overflows.  The count saturates at streamGapMax (63
+//without oversampling): a longer run of drops leaves the index behind by the
+//excess, for the rest of the stream.  ADC_StreamOverflowCount() still counts
+//every drop of a full ring.  The field shrinks as the result grows and is
+//gone at 16 bits, where the output rate is 4096 times lower.
+#define ADC_STREAM_RESULT_BITS  10
+
+//A late interrupt loses results too: the next Timer2 match starts another
+//conversion over the unread one.  Timer1 and Timer2 both count Fosc/4, so
+//with PR2 = 255 the PWM period that triggered the result in ADRES is
+//(TMR1 - streamTimer1Reference) >> 8, and the interrupt adds every period
+//it skipped to the gap tag.  Without oversampling a result is lost once the
+//interrupt is a full PWM period (256 cycles) late; with oversampling a
+//result missing one of its 4^n conversions is dropped as a gap as well.  An
+//interrupt that runs less than ADC_STREAM_LATE_MARGIN cycles before the next
+//ADIF is reported as one gap although nothing was lost.
+
+/** VARIABLES ******************************************************/
+//Ring buffer filled by ADC_InterruptHandler() and drained by ADC_StreamRead().
+//Head is only written by the ISR and tail only by the main loop, so no
+//locking is needed as long as both stay single byte.
+static uint16_t streamBuffer[ADC_STREAM_BUFFER_SIZE];
+static volatile uint8_t streamHead;
+static volatile uint8_t streamTail;
+static volatile uint16_t streamOverflowCount;
+static uint8_t streamGap;
+static uint8_t streamGapMax;
+static uint8_t streamGapShift;
+static uint16_t streamTimestamp;
+static bool streamRunning;
+
+//Timer1 value ADC_STREAM_LATE_MARGIN cycles before the conversion of PWM
+//period 0 would end, and the low byte of the period of the last result, see
+//ADC_InterruptHandler()
+static uint16_t streamTimer1Reference;
+static uint8_t streamPeriod;
+
+//Oversample and decimate state, see ADC_StreamStart()
+static uint8_t streamOversample;
+static uint16_t streamDecimation;
+static uint16_t streamDecimationPosition;
+static uint32_t streamAccumulator;
+static bool streamDecimationIncomplete;
+
+//Channel list converted by ADC_Scan()
+static uint8_t scanChannels[ADC_SCAN_MAX_CHANNELS];
+static uint8_t scanCount;
+
+/** PRIVATE PROTOTYPES *********************************************/
+static bool ADC_IsReadable(ADC_CHANNEL channel);
+static void ADC_SelectChannel(ADC_CHANNEL channel);
+static uint16_t ADC_Timer1(void);
+static void ADC_StreamAddGap(uint8_t count);
+
 /*********************************************************************
 * Function: ADC_ReadPercentage(ADC_CHANNEL channel);
 *
@@ -77,10 +145,16 @@ uint16_t get_adc_value_with_pwm ( ADC_CHANNEL channel , uint16_t pwm_value)
 {
     
     uint16_t result;
+
+    //The converter belongs to the stream engine while it is running
+    if(streamRunning == true)
+    {
+        return 0xFFFF;
+    }
     
     setPWM10bit( pwm_value );
     
-    ADCON0bits.CHS = channel;
+    ADC_SelectChannel(channel);
 
     ADCON0bits.GO = 1;              // Start AD conversion
     while(ADCON0bits.GO_nDONE);     // Wait for conversion
@@ -93,6 +167,74 @@ uint16_t get_adc_value_with_pwm ( ADC_CHANNEL channel , uint16_t pwm_value)
     
     
 }
+
+/*********************************************************************
+* Function: uint16_t ADC_ReadSynchronized(ADC_CHANNEL channel, uint16_t pwm_value, uint8_t settle_periods);
+*
+* Overview: Sets the PWM duty cycle and converts channel on a Timer2/PWM
+*           period boundary, after the new duty cycle has been applied
+*           for settle_periods whole periods.  The conversion is started
+*           by the Timer2 match auto-conversion trigger, so it is aligned
+*           to the period in hardware.
+*
+* PreCondition: channel is enabled via ADC_Enable(), PWM is enabled
+*
+* Input: ADC_CHANNEL channel - enumeration of the ADC channels
+*        uint16_t pwm_value - 10-bit PWM duty cycle
+*        uint8_t settle_periods - whole PWM periods to wait at the new
+*                                 duty cycle, 0 converts at the boundary
+*                                 where it takes effect
+*
+* Output: uint16_t the right adjusted 10-bit representation of the ADC
+*         channel conversion or 0xFFFF for an error.
+*
+********************************************************************/
+uint16_t ADC_ReadSynchronized(ADC_CHANNEL channel, uint16_t pwm_value, uint8_t settle_periods)
+{
+    uint16_t result;
+
+    switch(channel)
+    {
+        case ADC_CHANNEL_10:
+        case ADC_CHANNEL_3:
+            break;
+        default:
+            return 0xFFFF;
+    }
+
+    if(streamRunning == true)
+    {
+        return 0xFFFF;
+    }
+
+    ADC_SelectChannel(channel);
+
+    //The duty cycle registers are double buffered and only get loaded at
+    //the next period boundary.  If that boundary passes before TMR2IF is
+    //cleared, one extra period is waited, never one too few.
+    setPWM10bit(pwm_value);
+    PIR1bits.TMR2IF = 0;
+
+    while(settle_periods != 0)
+    {
+        while(PIR1bits.TMR2IF == 0);
+        PIR1bits.TMR2IF = 0;
+        settle_periods--;
+    }
+
+    //Let the next Timer2 match start the conversion
+    PIR1bits.ADIF = 0;
+    ADCON2 = ADC_TRIGGER_TIMER2_MATCH;
+    while(PIR1bits.ADIF == 0);
+    ADCON2 = ADC_TRIGGER_NONE;
+    PIR1bits.ADIF = 0;
+
+    result = ADRESH;
+    result <<=8;
+    result |= ADRESL;
+
+    return result;
+}
 /*********************************************************************
 * Function: ADC_Read10bit(ADC_CHANNEL channel);
 *
@@ -115,15 +257,17 @@ uint16_t ADC_Read10bit(ADC_CHANNEL channel)
 {
     uint16_t result;
 
-    switch(channel)
+    if(ADC_IsReadable(channel) == false)
     {
-        case ADC_CHANNEL_10:
-            break;
-        default:
-            return 0xFFFF;
+        return 0xFFFF;
     }
 
-    ADCON0bits.CHS = channel;
+    if(streamRunning == true)
+    {
+        return 0xFFFF;
+    }
+
+    ADC_SelectChannel(channel);
 
     ADCON0bits.GO = 1;              // Start AD conversion
     while(ADCON0bits.GO_nDONE);     // Wait for conversion
@@ -161,6 +305,15 @@ bool ADC_Enable(ADC_CHANNEL channel)
             ANSELAbits.ANSA4 = PIN_ANALOG;
             return true;
 
+        case ADC_CHANNEL_TEMPERATURE:
+            FVRCONbits.TSRNG = 1;   //high range, the board always runs from VBUS
+            FVRCONbits.TSEN = 1;
+            return true;
+
+        case ADC_CHANNEL_FVR:
+            //FVR is already on as the ADC reference
+            return true;
+
         default:
             return false;
     }
@@ -192,3 +345,496 @@ bool ADC_SetConfiguration(ADC_CONFIGURATION configuration)
 
     return false;
 }
+
+/*********************************************************************
+* Function: bool ADC_IsReadable(ADC_CHANNEL channel);
+*
+* Overview: Checks that channel is one the blocking readers support.
+*
+* PreCondition: none
+*
+* Input: ADC_CHANNEL channel - the channel to check
+*
+* Output: bool - true if channel can be converted.  false otherwise.
+*
+********************************************************************/
+static bool ADC_IsReadable(ADC_CHANNEL channel)
+{
+    switch(channel)
+    {
+        case ADC_CHANNEL_10:
+        case ADC_CHANNEL_3:
+        case ADC_CHANNEL_TEMPERATURE:
+        case ADC_CHANNEL_FVR:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/*********************************************************************
+* Function: void ADC_SelectChannel(ADC_CHANNEL channel);
+*
+* Overview: Points the mux at channel.  If that changes the channel, waits
+*           for the acquisition time (longer for the temperature indicator)
+*           before returning, so the next conversion is not taken on the
+*           hold capacitor still charged from the previous channel.
+*
+* PreCondition: none
+*
+* Input: ADC_CHANNEL channel - the channel to convert next
+*
+* Output: None
+*
+********************************************************************/
+static void ADC_SelectChannel(ADC_CHANNEL channel)
+{
+    if(ADCON0bits.CHS == channel)
+    {
+        return;
+    }
+
+    ADCON0bits.CHS = channel;
+    if(channel == ADC_CHANNEL_TEMPERATURE)
+    {
+        _delay(ADC_TEMPERATURE_ACQUISITION_CYCLES);
+    }
+    else
+    {
+        _delay(ADC_ACQUISITION_CYCLES);
+    }
+}
+
+/*********************************************************************
+* Function: bool ADC_ScanConfigure(const uint8_t* channels, uint8_t count);
+*
+* Overview: Sets the list of channels converted by ADC_Scan(), enabling
+*           each of them.  The previous list is kept on error.
+*
+* PreCondition: none
+*
+* Input: const uint8_t* channels - ADC_CHANNEL values, in scan order
+*        uint8_t count - 1 to ADC_SCAN_MAX_CHANNELS
+*
+* Output: bool - true if the list was accepted.  false otherwise.
+*
+********************************************************************/
+bool ADC_ScanConfigure(const uint8_t* channels, uint8_t count)
+{
+    uint8_t i;
+
+    if((count == 0) || (count > ADC_SCAN_MAX_CHANNELS))
+    {
+        return false;
+    }
+
+    for(i = 0; i < count; i++)
+    {
+        if(ADC_IsReadable((ADC_CHANNEL)channels[i]) == false)
+        {
+            return false;
+        }
+    }
+
+    for(i = 0; i < count; i++)
+    {
+        ADC_Enable((ADC_CHANNEL)channels[i]);
+        scanChannels[i] = channels[i];
+    }
+    scanCount = count;
+
+    return true;
+}
+
+/*********************************************************************
+* Function: uint8_t ADC_Scan(uint16_t* results);
+*
+* Overview: Converts every channel of the scan list back-to-back.  The
+*           mux is given its acquisition time after every channel change
+*           (longer for the temperature indicator), so a scan over
+*           several inputs reads each of them correctly.  The mux is left
+*           on the last channel of the list, the single channel readers
+*           give it the acquisition time again when they switch away.
+*
+* PreCondition: A scan list was set with ADC_ScanConfigure()
+*
+* Input: uint16_t* results - receives one 10-bit result per channel, in
+*                            scan order (0xFFFF while a stream is running)
+*
+* Output: uint8_t - number of results written
+*
+********************************************************************/
+uint8_t ADC_Scan(uint16_t* results)
+{
+    uint8_t i;
+    uint16_t result;
+
+    for(i = 0; i < scanCount; i++)
+    {
+        if(streamRunning == true)
+        {
+            results[i] = 0xFFFF;
+            continue;
+        }
+
+        ADC_SelectChannel((ADC_CHANNEL)scanChannels[i]);
+
+        ADCON0bits.GO = 1;              // Start AD conversion
+        while(ADCON0bits.GO_nDONE);     // Wait for conversion
+
+        result = ADRESH;
+        result <<=8;
+        result |= ADRESL;
+        results[i] = result;
+    }
+
+    return scanCount;
+}
+
+/*********************************************************************
+* Function: bool ADC_StreamStart(ADC_CHANNEL channel, uint8_t oversample);
+*
+* Overview: Starts continuous conversions of channel, triggered in
+*           hardware on every Timer2 match (one per PWM period), with
+*           the results collected by ADC_InterruptHandler().  With an
+*           oversample of n, 4^n conversions are summed and shifted right
+*           by n to give one (10 + n) bit result.
+*
+* PreCondition: channel is enabled via ADC_Enable(), Timer2 is running
+*
+* Input: ADC_CHANNEL channel - the channel to sample
+*        uint8_t oversample - 0 to ADC_OVERSAMPLE_MAX
+*
+* Output: bool - true if the stream was started.  false otherwise.
+*
+********************************************************************/
+bool ADC_StreamStart(ADC_CHANNEL channel, uint8_t oversample)
+{
+    ADC_StreamStop();
+
+    switch(channel)
+    {
+        case ADC_CHANNEL_10:
+        case ADC_CHANNEL_3:
+            break;
+        default:
+            return false;
+    }
+
+    if(oversample > ADC_OVERSAMPLE_MAX)
+    {
+        return false;
+    }
+
+    ADCON0bits.CHS = channel;
+
+    streamOversample = oversample;
+    streamDecimation = (uint16_t)1 << (oversample * 2);
+    streamDecimationPosition = 0;
+    streamAccumulator = 0;
+    streamDecimationIncomplete = false;
+
+    streamGapShift = ADC_STREAM_RESULT_BITS + oversample;
+    streamGapMax = (uint8_t)((1 << (ADC_OVERSAMPLE_MAX - oversample)) - 1);
+
+    streamHead = 0;
+    streamTail = 0;
+    streamOverflowCount = 0;
+    streamGap = 0;
+    streamTimestamp = 0xFFFF;
+    streamRunning = true;
+
+    //TMR2 is read a few cycles after Timer1, which moves the period
+    //boundaries that much earlier, well inside ADC_STREAM_LATE_MARGIN.  The
+    //first triggered conversion belongs to period 1.
+    T1GCON = 0x00;
+    T1CON = ADC_TIMER1_FOSC_4;
+    streamTimer1Reference = ADC_Timer1() + (ADC_CONVERSION_CYCLES - ADC_STREAM_LATE_MARGIN);
+    streamTimer1Reference -= TMR2;
+    streamPeriod = 0;
+
+    PIR1bits.ADIF = 0;
+    PIE1bits.ADIE = 1;
+    ADCON2 = ADC_TRIGGER_TIMER2_MATCH;
+
+    return true;
+}
+
+/*********************************************************************
+* Function: void ADC_StreamStop(void);
+*
+* Overview: Stops the hardware triggered conversions.  Samples already
+*           in the ring buffer are discarded.
+*
+* PreCondition: none
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+void ADC_StreamStop(void)
+{
+    ADCON2 = ADC_TRIGGER_NONE;
+    PIE1bits.ADIE = 0;
+
+    //let a conversion that was already triggered finish before the
+    //blocking readers are allowed back onto the converter
+    while(ADCON0bits.GO_nDONE);
+    PIR1bits.ADIF = 0;
+
+    streamTail = streamHead;
+    streamRunning = false;
+}
+
+/*********************************************************************
+* Function: uint8_t ADC_StreamAvailable(void);
+*
+* Overview: Returns the number of completed samples waiting in the
+*           ring buffer.
+*
+* PreCondition: none
+*
+* Input: None
+*
+* Output: uint8_t - number of samples that ADC_StreamRead() can return
+*
+********************************************************************/
+uint8_t ADC_StreamAvailable(void)
+{
+    return (uint8_t)(streamHead - streamTail) & ADC_STREAM_BUFFER_MASK;
+}
+
+/*********************************************************************
+* Function: uint16_t ADC_StreamRead(void);
+*
+* Overview: Removes the oldest sample from the ring buffer and advances
+*           the stream timestamp past it (and past any results that
+*           were dropped just before it).
+*
+* PreCondition: ADC_StreamAvailable() is not zero
+*
+* Input: None
+*
+* Output: uint16_t the right adjusted (10 + oversample) bit sample
+*
+********************************************************************/
+uint16_t ADC_StreamRead(void)
+{
+    uint16_t sample;
+
+    sample = streamBuffer[streamTail];
+    streamTail = (streamTail + 1) & ADC_STREAM_BUFFER_MASK;
+
+    if(streamGapMax == 0)
+    {
+        streamTimestamp++;
+        return sample;
+    }
+
+    streamTimestamp += (sample >> streamGapShift) + 1;
+
+    return sample & (((uint16_t)1 << streamGapShift) - 1);
+}
+
+/*********************************************************************
+* Function: uint8_t ADC_StreamOversample(void);
+*
+* Overview: Returns the oversample setting of the running stream.
+*
+* PreCondition: none
+*
+* Input: None
+*
+* Output: uint8_t - n, where each sample is 4^n conversions and 10 + n bits
+*
+********************************************************************/
+uint8_t ADC_StreamOversample(void)
+{
+    return streamOversample;
+}
+
+/*********************************************************************
+* Function: uint16_t ADC_StreamTimestamp(void);
+*
+* Overview: Returns the index of the sample most recently returned by
+*           ADC_StreamRead(), counted in output sample periods (4^n PWM
+*           periods) from the start of the stream.
+*
+* PreCondition: ADC_StreamRead() was called since ADC_StreamStart()
+*
+* Input: None
+*
+* Output: uint16_t - conversion index (wraps at 0xFFFF)
+*
+********************************************************************/
+uint16_t ADC_StreamTimestamp(void)
+{
+    return streamTimestamp;
+}
+
+/*********************************************************************
+* Function: uint16_t ADC_StreamOverflowCount(void);
+*
+* Overview: Returns how many samples were dropped because the ring
+*           buffer was full since the stream was started.
+*
+* PreCondition: none
+*
+* Input: None
+*
+* Output: uint16_t - dropped sample count (saturates at 0xFFFF)
+*
+********************************************************************/
+uint16_t ADC_StreamOverflowCount(void)
+{
+    uint16_t count;
+
+    PIE1bits.ADIE = 0;
+    count = streamOverflowCount;
+    PIE1bits.ADIE = streamRunning;
+
+    return count;
+}
+
+/*********************************************************************
+* Function: uint16_t ADC_Timer1(void);
+*
+* Overview: Reads the running Timer1 value.  TMR1H is read again after
+*           TMR1L so that a carry between the two reads is not missed.
+*
+* PreCondition: Timer1 runs, see ADC_StreamStart()
+*
+* Input: None
+*
+* Output: uint16_t - the current count
+*
+********************************************************************/
+static uint16_t ADC_Timer1(void)
+{
+    uint8_t high;
+    uint8_t low;
+
+    do
+    {
+        high = TMR1H;
+        low = TMR1L;
+    } while(high != TMR1H);
+
+    return ((uint16_t)high << 8) | low;
+}
+
+/*********************************************************************
+* Function: void ADC_StreamAddGap(uint8_t count);
+*
+* Overview: Adds count lost results to the gap tag of the next stored
+*           result, saturating at streamGapMax.
+*
+* PreCondition: ADC_StreamStart() was called
+*
+* Input: uint8_t count - results lost
+*
+* Output: None
+*
+********************************************************************/
+static void ADC_StreamAddGap(uint8_t count)
+{
+    if(count >= (uint8_t)(streamGapMax - streamGap))
+    {
+        streamGap = streamGapMax;
+    }
+    else
+    {
+        streamGap += count;
+    }
+}
+
+/*********************************************************************
+* Function: void ADC_InterruptHandler(void);
+*
+* Overview: Accumulates a completed conversion and stores every
+*           decimated result into the ring buffer, tagging the results
+*           lost to a full ring or to a late interrupt as a gap.  Called
+*           from the interrupt vector when ADIF is set.
+*
+* PreCondition: none
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+void ADC_InterruptHandler(void)
+{
+    uint8_t next;
+    uint8_t period;
+    uint8_t missed;
+    uint16_t result;
+
+    PIR1bits.ADIF = 0;
+    result = ((uint16_t)ADRESH << 8) | ADRESL;
+
+    //conversions of the periods between this one and the last were
+    //overwritten before the interrupt ran
+    period = (uint8_t)((uint16_t)(ADC_Timer1() - streamTimer1Reference) >> 8);
+    missed = (uint8_t)(period - streamPeriod) - 1;
+    streamPeriod = period;
+    if((missed != 0) && (missed != 0xFF))
+    {
+        if(streamOversample == 0)
+        {
+            ADC_StreamAddGap(missed);
+        }
+        else
+        {
+            //every result the missed conversions belonged to is dropped,
+            //including the one this conversion starts or continues
+            streamDecimationPosition += missed;
+            if(streamDecimationPosition >= streamDecimation)
+            {
+                ADC_StreamAddGap((uint8_t)(streamDecimationPosition >> (streamOversample * 2)));
+                streamDecimationPosition &= streamDecimation - 1;
+                streamAccumulator = 0;
+            }
+            streamDecimationIncomplete = (streamDecimationPosition != 0);
+        }
+    }
+
+    if(streamOversample != 0)
+    {
+        streamAccumulator += result;
+        if(++streamDecimationPosition != streamDecimation)
+        {
+            return;
+        }
+        result = (uint16_t)(streamAccumulator >> streamOversample);
+        streamAccumulator = 0;
+        streamDecimationPosition = 0;
+
+        if(streamDecimationIncomplete == true)
+        {
+            streamDecimationIncomplete = false;
+            ADC_StreamAddGap(1);
+            return;
+        }
+    }
+
+    next = (streamHead + 1) & ADC_STREAM_BUFFER_MASK;
+    if(next == streamTail)
+    {
+        if(streamOverflowCount != 0xFFFF)
+        {
+            streamOverflowCount++;
+        }
+        ADC_StreamAddGap(1);
+        return;
+    }
+
+    if(streamGap != 0)
+    {
+        result |= (uint16_t)streamGap << streamGapShift;
+        streamGap = 0;
+    }
+    streamBuffer[streamHead] = result;
+    streamHead = next;
+}
@@ -30,12 +30,26 @@
 /*** ADC Channel Definitions *****************************************/
 #define ADC_CHANNEL_INPUT ADC_CHANNEL_3
 
+/*** ADC Stream Definitions ******************************************/
+//RAM: the ring takes 2 * ADC_STREAM_BUFFER_SIZE = 256 bytes and the EUSART
+//rings (usart.h) 128 more, 384 of the 496 bytes of linear RAM outside the USB
+//dual port RAM (0x2200-0x23EF), counted from the declarations.  The rest of
+//the application, the compiled stack and the 110 byte table of
+//USB_ENABLE_CYCLE_PROFILING fit in what is left of it and of the dual port
+//RAM; check the memory summary of the XC8 build before growing either ring.
+#define ADC_STREAM_BUFFER_SIZE 128  //Ring buffer length in samples, must be a power of two
+#define ADC_OVERSAMPLE_MAX     6    //4^6 = 4096 conversions per 16-bit result
+
 typedef enum
 { 
     ADC_CHANNEL_10 = 10,
     ADC_CHANNEL_3 = 3,
+    ADC_CHANNEL_TEMPERATURE = 0x1D,     //Temperature indicator
+    ADC_CHANNEL_FVR = 0x1F,             //FVR buffer 1 output
 } ADC_CHANNEL;
 
+#define ADC_SCAN_MAX_CHANNELS 16
+
 typedef enum
 {
     ADC_CONFIGURATION_DEFAULT
@@ -79,6 +93,27 @@ uint8_t ADC_ReadPercentage(ADC_CHANNEL channel);
 
 uint16_t get_adc_value_with_pwm ( ADC_CHANNEL channel , uint16_t pwm_value); 
 
+/*********************************************************************
+* Function: uint16_t ADC_ReadSynchronized(ADC_CHANNEL channel, uint16_t pwm_value, uint8_t settle_periods);
+*
+* Overview: Sets the PWM duty cycle and converts channel on a Timer2/PWM
+*           period boundary, once the new duty cycle has been applied for
+*           settle_periods whole periods.
+*
+* PreCondition: channel is enabled via ADC_Enable(), PWM is enabled
+*
+* Input: ADC_CHANNEL channel - enumeration of the ADC channels
+*        uint16_t pwm_value - 10-bit PWM duty cycle
+*        uint8_t settle_periods - whole PWM periods to wait at the new
+*                                 duty cycle, 0 converts at the boundary
+*                                 where it takes effect
+*
+* Output: uint16_t the right adjusted 10-bit representation of the ADC
+*         channel conversion or 0xFFFF for an error.
+*
+********************************************************************/
+uint16_t ADC_ReadSynchronized(ADC_CHANNEL channel, uint16_t pwm_value, uint8_t settle_periods);
+
 /*********************************************************************
 * Function: ADC_Read10bit(ADC_CHANNEL channel);
 *
@@ -127,4 +162,163 @@ bool ADC_Enable(ADC_CHANNEL channel);
 ********************************************************************/
 bool ADC_SetConfiguration(ADC_CONFIGURATION configuration);
 
+/*********************************************************************
+* Function: bool ADC_ScanConfigure(const uint8_t* channels, uint8_t count);
+*
+* Overview: Sets the list of channels converted by ADC_Scan(), enabling
+*           each of them.  The previous list is kept on error.
+*
+* PreCondition: none
+*
+* Input: const uint8_t* channels - ADC_CHANNEL values, in scan order
+*        uint8_t count - 1 to ADC_SCAN_MAX_CHANNELS
+*
+* Output: bool - true if the list was accepted.  false otherwise.
+*
+********************************************************************/
+bool ADC_ScanConfigure(const uint8_t* channels, uint8_t count);
+
+/*********************************************************************
+* Function: uint8_t ADC_Scan(uint16_t* results);
+*
+* Overview: Converts every channel of the scan list back-to-back.
+*
+* PreCondition: A scan list was set with ADC_ScanConfigure()
+*
+* Input: uint16_t* results - receives one 10-bit result per channel, in
+*                            scan order (0xFFFF while a stream is running)
+*
+* Output: uint8_t - number of results written
+*
+********************************************************************/
+uint8_t ADC_Scan(uint16_t* results);
+
+/*********************************************************************
+* Function: bool ADC_StreamStart(ADC_CHANNEL channel, uint8_t oversample);
+*
+* Overview: Starts continuous conversions of channel, triggered in
+*           hardware on every Timer2 match (one per PWM period).  With an
+*           oversample of n, 4^n conversions are summed and decimated
+*           into one (10 + n) bit result, i.e. 2 gives 12-bit, 4 gives
+*           14-bit and 6 gives 16-bit samples.  While the stream runs the
+*           blocking read functions return 0xFFFF.  Timer1 is started free
+*           running at Fosc/4 to tell the results lost to a late interrupt,
+*           the same setting USB_ENABLE_CYCLE_PROFILING uses.
+*
+* PreCondition: channel is enabled via ADC_Enable(), PWM is enabled with
+*               PR2 = 255 and a 1:1 prescaler (PWM_CONFIGURATION_DEFAULT)
+*
+* Input: ADC_CHANNEL channel - the channel to sample
+*        uint8_t oversample - 0 to ADC_OVERSAMPLE_MAX
+*
+* Output: bool - true if the stream was started.  false otherwise.
+*
+********************************************************************/
+bool ADC_StreamStart(ADC_CHANNEL channel, uint8_t oversample);
+
+/*********************************************************************
+* Function: void ADC_StreamStop(void);
+*
+* Overview: Stops the hardware triggered conversions and discards any
+*           samples left in the ring buffer.
+*
+* PreCondition: none
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+void ADC_StreamStop(void);
+
+/*********************************************************************
+* Function: uint8_t ADC_StreamAvailable(void);
+*
+* Overview: Returns the number of completed samples waiting in the
+*           ring buffer.
+*
+* PreCondition: none
+*
+* Input: None
+*
+* Output: uint8_t - number of samples that ADC_StreamRead() can return
+*
+********************************************************************/
+uint8_t ADC_StreamAvailable(void);
+
+/*********************************************************************
+* Function: uint16_t ADC_StreamRead(void);
+*
+* Overview: Removes the oldest sample from the ring buffer.
+*
+* PreCondition: ADC_StreamAvailable() is not zero
+*
+* Input: None
+*
+* Output: uint16_t the right adjusted (10 + oversample) bit sample
+*
+********************************************************************/
+uint16_t ADC_StreamRead(void);
+
+/*********************************************************************
+* Function: uint8_t ADC_StreamOversample(void);
+*
+* Overview: Returns the oversample setting of the running stream.
+*
+* PreCondition: none
+*
+* Input: None
+*
+* Output: uint8_t - n, where each sample is 4^n conversions and 10 + n bits
+*
+********************************************************************/
+uint8_t ADC_StreamOversample(void);
+
+/*********************************************************************
+* Function: uint16_t ADC_StreamTimestamp(void);
+*
+* Overview: Returns the index of the sample most recently returned by
+*           ADC_StreamRead(), counted in output sample periods (4^n PWM
+*           periods) from the start of the stream.
+*
+* PreCondition: ADC_StreamRead() was called since ADC_StreamStart()
+*
+* Input: None
+*
+* Output: uint16_t - conversion index (wraps at 0xFFFF)
+*
+********************************************************************/
+uint16_t ADC_StreamTimestamp(void);
+
+/*********************************************************************
+* Function: uint16_t ADC_StreamOverflowCount(void);
+*
+* Overview: Returns how many samples were dropped because the ring
+*           buffer was full since the stream was started.
+*
+* PreCondition: none
+*
+* Input: None
+*
+* Output: uint16_t - dropped sample count (saturates at 0xFFFF)
+*
+********************************************************************/
+uint16_t ADC_StreamOverflowCount(void);
+
+/*********************************************************************
+* Function: void ADC_InterruptHandler(void);
+*
+* Overview: Moves a completed conversion into the ring buffer and tags the
+*           results lost to a full ring or to a late interrupt as a gap.
+*           Must be called from the interrupt vector when ADIF is set.
+*
+* PreCondition: none
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+void ADC_InterruptHandler(void);
+
 #endif  //ADC_H
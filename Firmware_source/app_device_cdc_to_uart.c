@@ -0,0 +1,93 @@
+/*******************************************************************************
+
+    Author:  Gaurav Singh
+    website: www.circuitvalley.com 
+    Created on October 28, 2017
+    
+    This file is part of Circuitvalley USB HID Bootloader.
+
+    Circuitvalley USB HID Bootloader is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Circuitvalley USB HID Bootloader is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Circuitvalley USB HID Bootloader.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+
+/** INCLUDES *******************************************************/
+#include "system.h"
+#include "usb.h"
+
+#if defined(USB_USE_CDC)
+
+#include "usb_device_cdc.h"
+#include "usart.h"
+#include "app_device_cdc_to_uart.h"
+
+/** VARIABLES ******************************************************/
+//One packet in either direction, the two never overlap
+static uint8_t cdcBuffer[CDC_DATA_IN_EP_SIZE];
+
+/** FUNCTIONS ******************************************************/
+
+/*********************************************************************
+* Function: void APP_DeviceCDCEmulatorTasks(void);
+*
+* Overview: Moves bytes between the CDC bulk endpoints and the EUSART
+*           ring buffers while a terminal has the port open (DTR set).
+*
+* PreCondition: CDCInitEP() was called on EVENT_CONFIGURED.
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+void APP_DeviceCDCEmulatorTasks(void)
+{
+    uint8_t count;
+
+    if((USBGetDeviceState() < CONFIGURED_STATE) || (USBIsDeviceSuspended() == true))
+    {
+        return;
+    }
+
+    //The EUSART is (re)started with the host's baud rate when a terminal
+    //opens the port.  The SET_LINE_CODING handler only notes the request,
+    //the restart empties the rings, so it happens here between the ring
+    //accesses.  The rings are shared with the HID bridge
+    //(COMMAND_UART_OPEN), only one of the two should have the port open at
+    //a time.
+    USART_LineCodingTasks();
+
+    if(CDCIsDTEPresent() == true)
+    {
+        //Only take a packet from the host once the TX ring can hold all of
+        //it, until then the bulk OUT endpoint NAKs.
+        if(USART_TxFree() >= CDC_DATA_OUT_EP_SIZE)
+        {
+            count = getsUSBUSART(cdcBuffer, CDC_DATA_OUT_EP_SIZE);
+            USART_WriteBuffer(cdcBuffer, count);
+        }
+
+        //Whatever arrived while the previous packet was in flight goes out
+        //in one packet, so the packets grow with the baud rate.
+        if((USBUSARTIsTxTrfReady() == true) && (USART_RxCount() != 0))
+        {
+            count = USART_ReadBuffer(cdcBuffer, sizeof(cdcBuffer));
+            putUSBUSART(cdcBuffer, count);
+        }
+    }
+
+    CDCTxService();
+}
+
+#endif //USB_USE_CDC
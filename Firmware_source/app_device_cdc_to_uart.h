@@ -0,0 +1,43 @@
+/*******************************************************************************
+
+    Author:  Gaurav Singh
+    website: www.circuitvalley.com 
+    Created on October 28, 2017
+    
+    This file is part of Circuitvalley USB HID Bootloader.
+
+    Circuitvalley USB HID Bootloader is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Circuitvalley USB HID Bootloader is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Circuitvalley USB HID Bootloader.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+
+#ifndef APP_DEVICE_CDC_TO_UART_H
+#define APP_DEVICE_CDC_TO_UART_H
+
+/*********************************************************************
+* Function: void APP_DeviceCDCEmulatorTasks(void);
+*
+* Overview: Moves bytes between the CDC bulk endpoints and the EUSART
+*           ring buffers while a terminal has the port open (DTR set).
+*
+* PreCondition: CDCInitEP() was called on EVENT_CONFIGURED.
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+void APP_DeviceCDCEmulatorTasks(void);
+
+#endif //APP_DEVICE_CDC_TO_UART_H
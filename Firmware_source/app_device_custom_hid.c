@@ -23,10 +23,17 @@
 /** INCLUDES *******************************************************/
 #include "usb.h"
 #include "usb_device_hid.h"
+#include "app_device_custom_hid.h"
 
 #include <string.h>
 
 #include "system.h"
+#include "pwm.h"
+#include "sample_pack.h"
+#include "usb_profile.h"
+#include "boot_request.h"
+#include "usart.h"
+#include "scheduler.h"
 
 
 /** VARIABLES ******************************************************/
@@ -35,34 +42,95 @@
  * assigns the buffers that need to be used by the USB module into those
  * specific areas.
  */
+/* Two OUT and two IN buffers are used, one per ping-pong buffer descriptor
+ * of the HID endpoint, so the host can keep two transactions in flight in
+ * each direction while the previous packet is being processed.
+ */
 #if defined(FIXED_ADDRESS_MEMORY)
     #if defined(COMPILER_MPLAB_C18)
         #pragma udata HID_CUSTOM_OUT_DATA_BUFFER = HID_CUSTOM_OUT_DATA_BUFFER_ADDRESS
-        unsigned char ReceivedDataBuffer[64];
+        unsigned char ReceivedDataBufferEven[64];
         #pragma udata HID_CUSTOM_IN_DATA_BUFFER = HID_CUSTOM_IN_DATA_BUFFER_ADDRESS
-        unsigned char ToSendDataBuffer[64];
+        unsigned char ToSendDataBufferEven[64];
+        #pragma udata HID_CUSTOM_OUT_ODD_DATA_BUFFER = HID_CUSTOM_OUT_ODD_DATA_BUFFER_ADDRESS
+        unsigned char ReceivedDataBufferOdd[64];
+        #pragma udata HID_CUSTOM_IN_ODD_DATA_BUFFER = HID_CUSTOM_IN_ODD_DATA_BUFFER_ADDRESS
+        unsigned char ToSendDataBufferOdd[64];
         #pragma udata
 
     #else defined(__XC8)
-        unsigned char ReceivedDataBuffer[64] @ HID_CUSTOM_OUT_DATA_BUFFER_ADDRESS;
-        unsigned char ToSendDataBuffer[64] @ HID_CUSTOM_IN_DATA_BUFFER_ADDRESS;
+        unsigned char ReceivedDataBufferEven[64] @ HID_CUSTOM_OUT_DATA_BUFFER_ADDRESS;
+        unsigned char ToSendDataBufferEven[64] @ HID_CUSTOM_IN_DATA_BUFFER_ADDRESS;
+        unsigned char ReceivedDataBufferOdd[64] @ HID_CUSTOM_OUT_ODD_DATA_BUFFER_ADDRESS;
+        unsigned char ToSendDataBufferOdd[64] @ HID_CUSTOM_IN_ODD_DATA_BUFFER_ADDRESS;
     #endif
 #else
-    unsigned char ReceivedDataBuffer[64];
-    unsigned char ToSendDataBuffer[64];
+    unsigned char ReceivedDataBufferEven[64];
+    unsigned char ToSendDataBufferEven[64];
+    unsigned char ReceivedDataBufferOdd[64];
+    unsigned char ToSendDataBufferOdd[64];
 #endif
 
-volatile USB_HANDLE USBOutHandle;    
-volatile USB_HANDLE USBInHandle;
+volatile USB_HANDLE USBOutHandle[2];
+volatile USB_HANDLE USBInHandle[2];
 
-/** DEFINITIONS ****************************************************/
-typedef enum
+/* With USB_USE_HID_STREAM the stream reports have their own interface and
+ * IN endpoint, so a command reply never waits behind them.
+ */
+#if defined(USB_USE_HID_STREAM)
+    #if defined(FIXED_ADDRESS_MEMORY)
+        unsigned char StreamDataBuffer[64] @ HID_STREAM_IN_DATA_BUFFER_ADDRESS;
+    #else
+        unsigned char StreamDataBuffer[64];
+    #endif
+
+    volatile USB_HANDLE USBStreamHandle;
+#endif
+
+//Index of the buffer (0 = even, 1 = odd) that the next OUT report completes
+//into, and of the buffer that the next IN report gets built in.  The SIE
+//alternates strictly between the even and odd descriptors, so these just
+//toggle after every packet.
+static uint8_t outBufferIndex;
+static uint8_t inBufferIndex;
+static unsigned char* ReceivedDataBuffer;
+static unsigned char* ToSendDataBuffer;
+
+static bool streamEnabled;
+static uint8_t streamSequence;
+
+//State of a running on-device PWM sweep (COMMAND_START_SWEEP)
+static struct
 {
-    COMMAND_TOGGLE_LED = 0x80,
-    COMMAND_GET_BUTTON_STATUS = 0x81,
-    COMMAND_READ_POTENTIOMETER = 0x37,
-    COMMAND_READ_ADC_WITH_PWM= 0x82,
-} CUSTOM_HID_DEMO_COMMANDS;
+    bool active;
+    uint16_t pwm;           //next duty cycle to measure
+    uint16_t stop;          //last duty cycle to measure
+    uint16_t step;
+    uint16_t settle;        //settle time after each duty change, in microseconds or PWM periods
+    bool synchronized;      //convert on a PWM period boundary, settle counted in periods
+    uint16_t index;         //index of the next point from the start of the sweep
+    uint8_t sequence;
+} sweep;
+
+//State of the USB to UART bridge (COMMAND_UART_OPEN)
+static struct
+{
+    bool active;
+    bool pending;           //RX bytes are waiting for a report
+    uint16_t since;         //SCHEDULER_Milliseconds() when they started waiting
+    uint8_t flushTime;      //ms a partial report may wait
+} bridge;
+
+/** DEFINITIONS ****************************************************/
+#define SWEEP_CYCLES_PER_US     8       //_delay() cycles that, with the loop overhead, take about 1us at 12 MIPS
+
+/** PRIVATE PROTOTYPES *********************************************/
+static void APP_DeviceCustomHIDStreamFill(uint8_t* report);
+static void APP_DeviceCustomHIDRunBatch(void);
+static void APP_DeviceCustomHIDSweepFill(void);
+static void APP_DeviceCustomHIDSend(void);
+static void APP_DeviceCustomHIDRearm(void);
+static void APP_DeviceCustomHIDBridgeFill(void);
 
 /** FUNCTIONS ******************************************************/
 
@@ -80,15 +148,33 @@ typedef enum
 ********************************************************************/
 void APP_DeviceCustomHIDInitialize()
 {
-    //initialize the variable holding the handle for the last
-    // transmission
-    USBInHandle = 0;
+    //initialize the variables holding the handles for the last
+    // transmissions
+    USBInHandle[0] = 0;
+    USBInHandle[1] = 0;
+    inBufferIndex = 0;
+    outBufferIndex = 0;
+    ReceivedDataBuffer = ReceivedDataBufferEven;
+    ToSendDataBuffer = ToSendDataBufferEven;
+
+    //a new configuration always starts with streaming and sweeps stopped
+    streamEnabled = false;
+    ADC_StreamStop();
+    sweep.active = false;
+    bridge.active = false;
 
     //enable the HID endpoint
     USBEnableEndpoint(CUSTOM_DEVICE_HID_EP, USB_IN_ENABLED|USB_OUT_ENABLED|USB_HANDSHAKE_ENABLED|USB_DISALLOW_SETUP);
 
-    //Re-arm the OUT endpoint for the next packet
-    USBOutHandle = (volatile USB_HANDLE)HIDRxPacket(CUSTOM_DEVICE_HID_EP,(uint8_t*)&ReceivedDataBuffer[0],64);
+    #if defined(USB_USE_HID_STREAM)
+        USBStreamHandle = 0;
+        USBEnableEndpoint(HID_STREAM_EP, USB_IN_ENABLED|USB_HANDSHAKE_ENABLED|USB_DISALLOW_SETUP);
+    #endif
+
+    //Arm both OUT ping-pong buffers, so the host can send the next packet
+    //while the first one is still being processed
+    USBOutHandle[0] = (volatile USB_HANDLE)HIDRxPacket(CUSTOM_DEVICE_HID_EP,(uint8_t*)&ReceivedDataBufferEven[0],64);
+    USBOutHandle[1] = (volatile USB_HANDLE)HIDRxPacket(CUSTOM_DEVICE_HID_EP,(uint8_t*)&ReceivedDataBufferOdd[0],64);
 }
 
 /*********************************************************************
@@ -124,8 +210,15 @@ void APP_DeviceCustomHIDTasks()
         return;
     }
     
-    //Check if we have received an OUT data packet from the host
-    if(HIDRxHandleBusy(USBOutHandle) == false)
+    //Check if we have received an OUT data packet from the host.  Commands
+    //are only taken once the next IN buffer is free, so that a reply never
+    //overwrites a report (or a stream report) still owned by the SIE.
+    //Bridge data is also held back while the TX ring can't take all of it,
+    //but only while the bridge is open: the ring of a closed bridge may never
+    //drain (the EUSART is not started before COMMAND_UART_OPEN).
+    if((HIDRxHandleBusy(USBOutHandle[outBufferIndex]) == false) && (HIDTxHandleBusy(USBInHandle[inBufferIndex]) == false)
+        && ((ReceivedDataBuffer[0] != COMMAND_UART_DATA) || (bridge.active == false)
+            || (USART_TxFree() >= ReceivedDataBuffer[1]) || (ReceivedDataBuffer[1] > UART_BRIDGE_PAYLOAD_SIZE)))
     {   
         //We just received a packet of data from the USB host.
         //Check the first uint8_t of the packet to see what command the host
@@ -145,13 +238,578 @@ void APP_DeviceCustomHIDTasks()
                 ToSendDataBuffer[2] = adc_result >> 8;
             
                 
-                USBInHandle = HIDTxPacket(CUSTOM_DEVICE_HID_EP, (uint8_t*)&ToSendDataBuffer[0],64);
+                APP_DeviceCustomHIDSend();
 
                 break;
             }
+
+            case COMMAND_READ_ADC_WITH_PWM_SYNC:
+            {
+                uint16_t PWM_value;
+                uint16_t adc_result;
+                PWM_value = ReceivedDataBuffer[1];
+                PWM_value = ReceivedDataBuffer[2] << 8 | PWM_value;
+                ToSendDataBuffer[0] = COMMAND_READ_ADC_WITH_PWM_SYNC;
+                adc_result = ADC_ReadSynchronized(ADC_CHANNEL_INPUT, PWM_value, ReceivedDataBuffer[3]);
+                ToSendDataBuffer[1] = adc_result;
+                ToSendDataBuffer[2] = adc_result >> 8;
+
+                APP_DeviceCustomHIDSend();
+
+                break;
+            }
+
+            case COMMAND_SCAN_CONFIGURE:
+            {
+                ToSendDataBuffer[0] = COMMAND_SCAN_CONFIGURE;
+                ToSendDataBuffer[1] = 0;
+                if(ReceivedDataBuffer[1] <= ADC_SCAN_MAX_CHANNELS)
+                {
+                    ToSendDataBuffer[1] = ADC_ScanConfigure(&ReceivedDataBuffer[2], ReceivedDataBuffer[1]);
+                }
+
+                APP_DeviceCustomHIDSend();
+
+                break;
+            }
+
+            case COMMAND_SCAN_READ:
+            {
+                uint16_t results[ADC_SCAN_MAX_CHANNELS];
+                uint8_t count;
+                uint8_t i;
+
+                count = ADC_Scan(results);
+                ToSendDataBuffer[0] = COMMAND_SCAN_READ;
+                ToSendDataBuffer[1] = count;
+                for(i = 0; i < count; i++)
+                {
+                    ToSendDataBuffer[2 + (i * 2)] = results[i];
+                    ToSendDataBuffer[3 + (i * 2)] = results[i] >> 8;
+                }
+
+                APP_DeviceCustomHIDSend();
+
+                break;
+            }
+
+            case COMMAND_GET_USB_PROFILE:
+            {
+                ToSendDataBuffer[0] = COMMAND_GET_USB_PROFILE;
+                #if defined(USB_ENABLE_CYCLE_PROFILING)
+                    USB_ProfileReport(&ToSendDataBuffer[1], ReceivedDataBuffer[2], (ReceivedDataBuffer[1] != 0));
+                #else
+                    ToSendDataBuffer[1] = 0;
+                #endif
+
+                APP_DeviceCustomHIDSend();
+
+                break;
+            }
+
+            case COMMAND_ENTER_BOOTLOADER:
+            {
+                if((ReceivedDataBuffer[1] | ((uint16_t)ReceivedDataBuffer[2] << 8)) == ENTER_BOOTLOADER_KEY)
+                {
+                    BOOT_EnterBootloader();
+                }
+                break;
+            }
+
+            case COMMAND_UART_OPEN:
+            {
+                uint32_t baudRate;
+
+                baudRate = ReceivedDataBuffer[1] | ((uint16_t)ReceivedDataBuffer[2] << 8)
+                    | ((uint32_t)ReceivedDataBuffer[3] << 16) | ((uint32_t)ReceivedDataBuffer[4] << 24);
+                bridge.active = false;
+                if(baudRate != 0)
+                {
+                    USART_SetBaudRate(baudRate);
+                    USART_Initialize();
+                    bridge.flushTime = (ReceivedDataBuffer[5] != 0) ? ReceivedDataBuffer[5] : UART_BRIDGE_FLUSH_TIME_DEFAULT;
+                    bridge.pending = false;
+                    bridge.active = true;
+                }
+                ToSendDataBuffer[0] = COMMAND_UART_OPEN;
+                ToSendDataBuffer[1] = bridge.active;
+
+                APP_DeviceCustomHIDSend();
+
+                break;
+            }
+
+            case COMMAND_UART_CLOSE:
+            {
+                bridge.active = false;
+                break;
+            }
+
+            case COMMAND_UART_DATA:
+            {
+                //an over long report, or one for a closed bridge, is dropped
+                //rather than held back forever
+                if((bridge.active == true) && (ReceivedDataBuffer[1] <= UART_BRIDGE_PAYLOAD_SIZE))
+                {
+                    USART_WriteBuffer(&ReceivedDataBuffer[UART_BRIDGE_HEADER_SIZE], ReceivedDataBuffer[1]);
+                }
+                break;
+            }
+
+            case COMMAND_UART_STATUS:
+            {
+                USART_STATISTICS statistics;
+
+                USART_GetStatistics(&statistics, (ReceivedDataBuffer[1] != 0));
+                ToSendDataBuffer[0] = COMMAND_UART_STATUS;
+                ToSendDataBuffer[1] = statistics.rxBufferOverruns;
+                ToSendDataBuffer[2] = statistics.rxBufferOverruns >> 8;
+                ToSendDataBuffer[3] = statistics.rxHardwareOverruns;
+                ToSendDataBuffer[4] = statistics.rxHardwareOverruns >> 8;
+                ToSendDataBuffer[5] = statistics.rxFramingErrors;
+                ToSendDataBuffer[6] = statistics.rxFramingErrors >> 8;
+                ToSendDataBuffer[7] = USART_RxCount();
+                ToSendDataBuffer[8] = USART_TxFree();
+
+                APP_DeviceCustomHIDSend();
+
+                break;
+            }
+
+            case COMMAND_START_STREAM:
+            {
+                ADC_CHANNEL channel;
+
+                //[1] selects the channel, 0 means the default input channel
+                channel = ADC_CHANNEL_INPUT;
+                if(ReceivedDataBuffer[1] != 0)
+                {
+                    channel = (ADC_CHANNEL)ReceivedDataBuffer[1];
+                }
+                //the stream needs the converter, so it replaces a running sweep
+                sweep.active = false;
+                streamSequence = 0;
+                streamEnabled = ADC_StreamStart(channel, ReceivedDataBuffer[2]);
+                break;
+            }
+
+            case COMMAND_STOP_STREAM:
+            {
+                streamEnabled = false;
+                ADC_StreamStop();
+                break;
+            }
+
+            case COMMAND_BATCH:
+            {
+                APP_DeviceCustomHIDRunBatch();
+                APP_DeviceCustomHIDSend();
+                break;
+            }
+
+            case COMMAND_START_SWEEP:
+            {
+                //a sweep needs the converter, so it replaces a running stream
+                streamEnabled = false;
+                ADC_StreamStop();
+
+                sweep.pwm = ReceivedDataBuffer[1] | ((uint16_t)ReceivedDataBuffer[2] << 8);
+                sweep.stop = ReceivedDataBuffer[3] | ((uint16_t)ReceivedDataBuffer[4] << 8);
+                sweep.step = ReceivedDataBuffer[5] | ((uint16_t)ReceivedDataBuffer[6] << 8);
+                sweep.settle = ReceivedDataBuffer[7] | ((uint16_t)ReceivedDataBuffer[8] << 8);
+                sweep.synchronized = (ReceivedDataBuffer[9] == SWEEP_MODE_SYNCHRONIZED);
+                sweep.index = 0;
+                sweep.sequence = 0;
+                sweep.active = (sweep.step != 0) && (sweep.pwm <= sweep.stop) && (sweep.stop <= SWEEP_PWM_MAX)
+                    && (sweep.settle <= ((sweep.synchronized == true) ? SWEEP_SETTLE_PERIODS_MAX : SWEEP_SETTLE_US_MAX));
+                break;
+            }
         }
         //Re-arm the OUT endpoint, so we can receive the next OUT data packet 
         //that the host may try to send us.
-        USBOutHandle = HIDRxPacket(CUSTOM_DEVICE_HID_EP, (uint8_t*)&ReceivedDataBuffer[0], 64);
+        APP_DeviceCustomHIDRearm();
+    }
+
+    //While a stream is running, send a report as soon as the sampling
+    //engine has collected enough samples and the IN endpoint is free,
+    //without waiting for the host to ask for it.
+    if((streamEnabled == true)
+        && (ADC_StreamAvailable() >= ((ADC_StreamOversample() == 0) ? SAMPLE_PACK_SAMPLES_PER_REPORT : STREAM_WIDE_SAMPLES_PER_REPORT)))
+    {
+        #if defined(USB_USE_HID_STREAM)
+        if(HIDTxHandleBusy(USBStreamHandle) == false)
+        {
+            APP_DeviceCustomHIDStreamFill(StreamDataBuffer);
+            USBStreamHandle = HIDTxPacket(HID_STREAM_EP, (uint8_t*)&StreamDataBuffer[0], 64);
+        }
+        #else
+        if(HIDTxHandleBusy(USBInHandle[inBufferIndex]) == false)
+        {
+            APP_DeviceCustomHIDStreamFill(ToSendDataBuffer);
+            APP_DeviceCustomHIDSend();
+        }
+        #endif
+    }
+
+    //A running sweep measures the next report worth of points each time
+    //an IN buffer frees up.
+    if((sweep.active == true) && (HIDTxHandleBusy(USBInHandle[inBufferIndex]) == false))
+    {
+        APP_DeviceCustomHIDSweepFill();
+        APP_DeviceCustomHIDSend();
+    }
+
+    //The bridge sends received bytes once a report is full, or once the
+    //oldest of them has waited the flush time.
+    if(bridge.active == true)
+    {
+        uint8_t count;
+
+        count = USART_RxCount();
+        if(count == 0)
+        {
+            bridge.pending = false;
+        }
+        else if(bridge.pending == false)
+        {
+            bridge.pending = true;
+            bridge.since = SCHEDULER_Milliseconds();
+        }
+
+        if((bridge.pending == true) && (HIDTxHandleBusy(USBInHandle[inBufferIndex]) == false)
+            && ((count >= UART_BRIDGE_PAYLOAD_SIZE) || ((uint16_t)(SCHEDULER_Milliseconds() - bridge.since) >= bridge.flushTime)))
+        {
+            APP_DeviceCustomHIDBridgeFill();
+            APP_DeviceCustomHIDSend();
+        }
+    }
+}
+
+/*********************************************************************
+* Function: void APP_DeviceCustomHIDBridgeFill(void);
+*
+* Overview: Fills ToSendDataBuffer with a COMMAND_UART_DATA report of up to
+*           UART_BRIDGE_PAYLOAD_SIZE bytes drained from the UART RX ring.
+*           Bytes left behind start a new flush time.
+*
+* PreCondition: The bridge is open and the current IN buffer is not busy.
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+static void APP_DeviceCustomHIDBridgeFill(void)
+{
+    ToSendDataBuffer[0] = COMMAND_UART_DATA;
+    ToSendDataBuffer[1] = USART_ReadBuffer(&ToSendDataBuffer[UART_BRIDGE_HEADER_SIZE], UART_BRIDGE_PAYLOAD_SIZE);
+
+    bridge.pending = false;
+}
+
+/*********************************************************************
+* Function: void APP_DeviceCustomHIDSweepFill(void);
+*
+* Overview: Steps the PWM through the next SWEEP_POINTS_PER_REPORT points
+*           of the running sweep, reading ADC_CHANNEL_INPUT after each
+*           settle time (or period aligned in the synchronized mode),
+*           and packs the (pwm, adc) pairs into
+*           ToSendDataBuffer.  Ends the sweep after its last point.
+*
+* PreCondition: A sweep was started with COMMAND_START_SWEEP and the
+*   current IN buffer is not busy.
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+static void APP_DeviceCustomHIDSweepFill(void)
+{
+    uint8_t i;
+    uint8_t index;
+    uint16_t settle;
+    uint16_t group[SAMPLE_PACK_GROUP_SAMPLES];
+    uint8_t type;
+
+    memset(&ToSendDataBuffer[0], 0, 64);
+    type = COMMAND_SWEEP_DATA;
+
+    index = SAMPLE_PACK_HEADER_SIZE;
+    for(i = 0; i < SWEEP_POINTS_PER_REPORT; i++)
+    {
+        if(sweep.active == true)
+        {
+            group[(i & 1) << 1] = sweep.pwm;
+            if(sweep.synchronized == true)
+            {
+                group[((i & 1) << 1) + 1] = ADC_ReadSynchronized(ADC_CHANNEL_INPUT, sweep.pwm, (uint8_t)sweep.settle);   //at most SWEEP_SETTLE_PERIODS_MAX
+            }
+            else
+            {
+                setPWM10bit(sweep.pwm);
+                for(settle = sweep.settle; settle != 0; settle--)
+                {
+                    _delay(SWEEP_CYCLES_PER_US);
+                }
+                group[((i & 1) << 1) + 1] = ADC_Read10bit(ADC_CHANNEL_INPUT);
+            }
+
+            //stop after the last point, also when the next step would
+            //run past the 10-bit range
+            if((sweep.stop - sweep.pwm) < sweep.step)
+            {
+                sweep.active = false;
+                type = COMMAND_SWEEP_END;
+            }
+            sweep.pwm += sweep.step;
+        }
+        else
+        {
+            group[(i & 1) << 1] = 0;
+            group[((i & 1) << 1) + 1] = 0;
+        }
+
+        //two points make up a group of four packed samples
+        if((i & 1) == 1)
+        {
+            SAMPLE_PackGroup(&ToSendDataBuffer[index], group);
+            index += SAMPLE_PACK_GROUP_SIZE;
+        }
+    }
+
+    SAMPLE_PackHeader(&ToSendDataBuffer[0], type, sweep.sequence++, sweep.index);
+    sweep.index += SWEEP_POINTS_PER_REPORT;
+}
+
+/*********************************************************************
+* Function: void APP_DeviceCustomHIDRunBatch(void);
+*
+* Overview: Runs every operation of a COMMAND_BATCH report in order and
+*           builds the single reply report holding all of their results.
+*
+* PreCondition: ReceivedDataBuffer holds a COMMAND_BATCH report and the
+*   current IN buffer is not busy.
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+static void APP_DeviceCustomHIDRunBatch(void)
+{
+    uint8_t in;
+    uint8_t out;
+    uint8_t count;
+    uint8_t operation;
+    uint8_t length;
+    uint16_t value;
+    uint16_t result;
+    CUSTOM_HID_BATCH_STATUS status;
+
+    in = 1;
+    out = BATCH_REPLY_HEADER_SIZE;
+    count = 0;
+    status = BATCH_STATUS_OK;
+
+    while(in < 64)
+    {
+        operation = ReceivedDataBuffer[in] >> 4;
+        length = ReceivedDataBuffer[in] & 0x0F;
+        in++;
+
+        if(operation == BATCH_OP_END)
+        {
+            break;
+        }
+
+        if((in + length) > 64)
+        {
+            status = BATCH_STATUS_TRUNCATED;
+            break;
+        }
+
+        //every operation except SET_PWM returns one 16-bit result
+        if((operation != BATCH_OP_SET_PWM) && ((out + 2) > 64))
+        {
+            status = BATCH_STATUS_REPLY_FULL;
+            break;
+        }
+
+        value = 0;
+        if(length != 0)
+        {
+            value = ReceivedDataBuffer[in];
+        }
+        if(length >= 2)
+        {
+            value |= (uint16_t)ReceivedDataBuffer[in + 1] << 8;
+        }
+
+        switch(operation)
+        {
+            case BATCH_OP_SET_PWM:
+                if(length != 2)
+                {
+                    status = BATCH_STATUS_BAD_OPERATION;
+                    break;
+                }
+                setPWM10bit(value);
+                break;
+
+            case BATCH_OP_READ_ADC:
+                if(length == 0)
+                {
+                    result = ADC_Read10bit(ADC_CHANNEL_INPUT);
+                }
+                else if(length == 1)
+                {
+                    result = ADC_Read10bit((ADC_CHANNEL)value);
+                }
+                else
+                {
+                    status = BATCH_STATUS_BAD_OPERATION;
+                }
+                break;
+
+            case BATCH_OP_READ_ADC_WITH_PWM:
+                if(length != 2)
+                {
+                    status = BATCH_STATUS_BAD_OPERATION;
+                    break;
+                }
+                result = get_adc_value_with_pwm(ADC_CHANNEL_INPUT, value);
+                break;
+
+            case BATCH_OP_READ_ADC_SYNC:
+                if(length != 3)
+                {
+                    status = BATCH_STATUS_BAD_OPERATION;
+                    break;
+                }
+                result = ADC_ReadSynchronized(ADC_CHANNEL_INPUT, value, ReceivedDataBuffer[in + 2]);
+                break;
+
+            default:
+                status = BATCH_STATUS_BAD_OPERATION;
+                break;
+        }
+
+        if(status != BATCH_STATUS_OK)
+        {
+            break;
+        }
+
+        if(operation != BATCH_OP_SET_PWM)
+        {
+            ToSendDataBuffer[out++] = result;
+            ToSendDataBuffer[out++] = result >> 8;
+        }
+
+        in += length;
+        count++;
+    }
+
+    ToSendDataBuffer[0] = COMMAND_BATCH;
+    ToSendDataBuffer[1] = count;
+    ToSendDataBuffer[2] = status;
+}
+
+/*********************************************************************
+* Function: void APP_DeviceCustomHIDSend(void);
+*
+* Overview: Hands ToSendDataBuffer to the SIE and moves ToSendDataBuffer
+*           on to the other IN ping-pong buffer.
+*
+* PreCondition: The current IN buffer is not busy.
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+static void APP_DeviceCustomHIDSend(void)
+{
+    USBInHandle[inBufferIndex] = HIDTxPacket(CUSTOM_DEVICE_HID_EP, (uint8_t*)&ToSendDataBuffer[0], 64);
+
+    inBufferIndex ^= 1;
+    ToSendDataBuffer = (inBufferIndex == 0) ? ToSendDataBufferEven : ToSendDataBufferOdd;
+}
+
+/*********************************************************************
+* Function: void APP_DeviceCustomHIDRearm(void);
+*
+* Overview: Gives the OUT buffer that was just processed back to the SIE
+*           and moves ReceivedDataBuffer on to the other OUT buffer.
+*
+* PreCondition: The current OUT buffer has been processed.
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+static void APP_DeviceCustomHIDRearm(void)
+{
+    USBOutHandle[outBufferIndex] = HIDRxPacket(CUSTOM_DEVICE_HID_EP, (uint8_t*)&ReceivedDataBuffer[0], 64);
+
+    outBufferIndex ^= 1;
+    ReceivedDataBuffer = (outBufferIndex == 0) ? ReceivedDataBufferEven : ReceivedDataBufferOdd;
+}
+
+/*********************************************************************
+* Function: void APP_DeviceCustomHIDStreamFill(uint8_t* report);
+*
+* Overview: Fills a 64 byte report buffer with a stream report of samples
+*           drained from the ADC sampling engine, packed (see
+*           sample_pack.h) for 10-bit samples and 16 bits wide for
+*           oversampled ones.
+*
+* PreCondition: A stream was started with COMMAND_START_STREAM, the IN
+*   endpoint is not busy and ADC_StreamAvailable() holds at least one
+*   report worth of samples.
+*
+* Input: uint8_t* report - the HID IN buffer to fill
+*
+* Output: None
+*
+********************************************************************/
+static void APP_DeviceCustomHIDStreamFill(uint8_t* report)
+{
+    uint8_t i;
+    uint8_t index;
+    uint16_t group[SAMPLE_PACK_GROUP_SAMPLES];
+
+    index = SAMPLE_PACK_HEADER_SIZE;
+
+    if(ADC_StreamOversample() != 0)
+    {
+        for(i = 0; i < STREAM_WIDE_SAMPLES_PER_REPORT; i++)
+        {
+            group[0] = ADC_StreamRead();
+            if(i == 0)
+            {
+                SAMPLE_PackHeader(&report[0], COMMAND_STREAM_DATA_WIDE, streamSequence++, ADC_StreamTimestamp());
+            }
+            report[index++] = group[0];
+            report[index++] = group[0] >> 8;
+        }
+        return;
+    }
+
+    for(i = 0; i < SAMPLE_PACK_GROUPS_PER_REPORT; i++)
+    {
+        group[0] = ADC_StreamRead();
+        if(i == 0)
+        {
+            //the header carries the conversion index of the first sample
+            SAMPLE_PackHeader(&report[0], COMMAND_STREAM_DATA, streamSequence++, ADC_StreamTimestamp());
+        }
+        group[1] = ADC_StreamRead();
+        group[2] = ADC_StreamRead();
+        group[3] = ADC_StreamRead();
+
+        SAMPLE_PackGroup(&report[index], group);
+        index += SAMPLE_PACK_GROUP_SIZE;
     }
 }
\ No newline at end of file
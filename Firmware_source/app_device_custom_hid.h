@@ -20,6 +20,167 @@
     along with Circuitvalley USB HID Bootloader.  If not, see <http://www.gnu.org/licenses/>.
 *******************************************************************************/
 
+
+
+#ifndef APP_DEVICE_CUSTOM_HID_H
+#define APP_DEVICE_CUSTOM_HID_H
+
+#include <stdint.h>
+
+#include "sample_pack.h"
+
+/*** Custom HID Command Reports ***************************************/
+//Every report starts with one of these commands in [0].  A reply, when the
+//command has one, starts with the same command.
+typedef enum
+{
+    COMMAND_TOGGLE_LED = 0x80,
+    COMMAND_GET_BUTTON_STATUS = 0x81,
+    COMMAND_READ_POTENTIOMETER = 0x37,
+    COMMAND_READ_ADC_WITH_PWM= 0x82,
+    COMMAND_START_STREAM = 0x83,
+    COMMAND_STOP_STREAM = 0x84,
+    COMMAND_STREAM_DATA = 0x85,
+    COMMAND_BATCH = 0x86,
+    COMMAND_START_SWEEP = 0x87,
+    COMMAND_SWEEP_DATA = 0x88,
+    COMMAND_SWEEP_END = 0x89,
+    COMMAND_READ_ADC_WITH_PWM_SYNC = 0x8A,
+    COMMAND_STREAM_DATA_WIDE = 0x8B,
+    COMMAND_SCAN_CONFIGURE = 0x8C,
+    COMMAND_SCAN_READ = 0x8D,
+    COMMAND_GET_USB_PROFILE = 0x8E,
+    COMMAND_ENTER_BOOTLOADER = 0x8F,
+    COMMAND_UART_OPEN = 0x90,
+    COMMAND_UART_CLOSE = 0x91,
+    COMMAND_UART_DATA = 0x92,
+    COMMAND_UART_STATUS = 0x93,
+} CUSTOM_HID_DEMO_COMMANDS;
+
+/* COMMAND_START_STREAM: [1] channel (0 for the input channel), [2] oversample
+ * n (0 to ADC_OVERSAMPLE_MAX).  Without oversampling the samples arrive in
+ * packed COMMAND_STREAM_DATA reports (see sample_pack.h).  With oversampling
+ * every sample is 4^n conversions decimated to 10 + n bits, sent in
+ * COMMAND_STREAM_DATA_WIDE reports: the same 4 byte header followed by
+ * STREAM_WIDE_SAMPLES_PER_REPORT 16-bit samples, low byte first.  In both
+ * cases the timestamp counts output samples.
+ *
+ * Builds with USB_USE_HID_STREAM always send the stream reports on the IN
+ * endpoint of the second HID interface (HID_STREAM_EP), the host reads them
+ * from that interface's device node.
+ */
+#define STREAM_WIDE_SAMPLES_PER_REPORT  ((64 - SAMPLE_PACK_HEADER_SIZE) / 2)
+
+/* COMMAND_READ_ADC_WITH_PWM_SYNC: [1..2] pwm, [3] settle periods.  Converts on
+ * a Timer2/PWM period boundary once the new duty cycle has been applied for
+ * the given number of whole periods, see ADC_ReadSynchronized().  The reply
+ * has the same layout as the COMMAND_READ_ADC_WITH_PWM one.
+ */
+
+/* COMMAND_SCAN_CONFIGURE: [1] count, [2..] count ADC_CHANNEL values, at
+ * most ADC_SCAN_MAX_CHANNELS.  The channels may include the temperature
+ * indicator (0x1D) and the FVR (0x1F).  The reply is [0] the command and [1]
+ * 1 if the list was accepted, 0 if not (the previous list is kept).
+ *
+ * COMMAND_SCAN_READ: converts the whole list back-to-back and replies with
+ * [0] the command, [1] count, then one 16-bit result per channel in list
+ * order, low byte first.
+ */
+
+/* COMMAND_GET_USB_PROFILE: [1] non zero clears the statistics once read,
+ * [2] the first event to read.  The reply is [0] the command followed by one
+ * page of the USB_ProfileReport() table (see usb_profile.h), the host asks
+ * again from the next event until it has all USB_PROFILE_EVENT_COUNT of
+ * them.  Builds without USB_ENABLE_CYCLE_PROFILING reply with an event count
+ * of 0.
+ */
+
+/* COMMAND_ENTER_BOOTLOADER: [1..2] ENTER_BOOTLOADER_KEY, low byte first, so
+ * a stray report can not trigger it.  The device detaches without a reply and
+ * comes back as the HID bootloader (see boot_request.h).
+ */
+#define ENTER_BOOTLOADER_KEY    0xB007
+
+/* COMMAND_UART_OPEN: [1..4] baud rate, low byte first, [5] flush time in ms
+ * (0 for UART_BRIDGE_FLUSH_TIME_DEFAULT).  Restarts the EUSART with empty
+ * buffers and starts the bridge.  The reply is [0] the command and [1] 1 if
+ * the bridge was opened, 0 for a zero baud rate.
+ *
+ * COMMAND_UART_CLOSE: stops forwarding received bytes, the port keeps
+ * running.  No reply.
+ *
+ * COMMAND_UART_DATA: [1] length, at most UART_BRIDGE_PAYLOAD_SIZE, [2..] the
+ * bytes to send.  The report is left in its OUT buffer, so the host is NAKed,
+ * until the TX ring has room for all of it.  Dropped while the bridge is not
+ * open.  No reply.  In the other
+ * direction the firmware sends reports of the same layout with the received
+ * bytes as soon as a full payload has arrived, or once the first of them has
+ * waited the flush time.
+ *
+ * COMMAND_UART_STATUS: [1] non zero clears the counters once read.  The reply
+ * is [0] the command, [1..2] bytes dropped on a full RX ring, [3..4] hardware
+ * overruns, [5..6] framing errors, all low byte first, [7] bytes waiting in
+ * the RX ring and [8] free space in the TX ring.
+ */
+#define UART_BRIDGE_HEADER_SIZE         2
+#define UART_BRIDGE_PAYLOAD_SIZE        (64 - UART_BRIDGE_HEADER_SIZE)
+#define UART_BRIDGE_FLUSH_TIME_DEFAULT  2
+
+/* COMMAND_START_SWEEP: [1..2] start pwm, [3..4] stop pwm, [5..6] step,
+ * [7..8] settle time, all low byte first, and [9] mode.  With mode 0 the
+ * settle time is in microseconds (at most SWEEP_SETTLE_US_MAX) and the
+ * conversion starts right after it.  With mode 1 (SWEEP_MODE_SYNCHRONIZED)
+ * the settle time is in whole PWM periods (at most SWEEP_SETTLE_PERIODS_MAX)
+ * and the conversion is aligned to a period boundary, as with
+ * COMMAND_READ_ADC_WITH_PWM_SYNC.  A sweep with a longer settle time, a zero
+ * step or a start above the stop is not started.  The firmware then
+ * sends packed reports (see sample_pack.h) of type COMMAND_SWEEP_DATA holding
+ * SWEEP_POINTS_PER_REPORT (pwm, adc) pairs, the pwm in the even sample slots
+ * and the matching adc result in the odd ones.  The header timestamp is the
+ * index of the first point in the report.  The last report of the sweep has
+ * the type COMMAND_SWEEP_END, with its unused pairs zero filled.
+ */
+#define SWEEP_POINTS_PER_REPORT (SAMPLE_PACK_SAMPLES_PER_REPORT / 2)
+#define SWEEP_MODE_SYNCHRONIZED 0x01
+#define SWEEP_PWM_MAX           0x3FF
+
+/* A report worth of points is measured in one main loop pass, so the settle
+ * time bounds how long the sweep holds up everything else (the UART bridge,
+ * the scheduler tasks, the LED).  About 1ms per point in either mode keeps a
+ * report under 25ms: 47 periods of the 21.3us PWM period (PR2 = 255,
+ * prescaler 1) are 1.0ms.
+ */
+#define SWEEP_SETTLE_US_MAX         1000
+#define SWEEP_SETTLE_PERIODS_MAX    47
+
+/* COMMAND_BATCH carries a sequence of operations in [1..63].  Each one is a
+ * tag byte, with the operation in bits 7:4 and the value length in bits 3:0,
+ * followed by that many value bytes (16-bit values low byte first).  The list
+ * ends at BATCH_OP_END or at the end of the report.
+ *
+ * The reply is [0] COMMAND_BATCH, [1] number of operations run, [2] a
+ * BATCH_STATUS and from [3] on the 16-bit result of every operation that
+ * returns one, in order, low byte first.
+ */
+typedef enum
+{
+    BATCH_OP_END = 0x0,
+    BATCH_OP_SET_PWM = 0x1,             //value: pwm (2 bytes), no result
+    BATCH_OP_READ_ADC = 0x2,            //value: none for the input channel, or channel (1 byte)
+    BATCH_OP_READ_ADC_WITH_PWM = 0x3,   //value: pwm (2 bytes), result as COMMAND_READ_ADC_WITH_PWM
+    BATCH_OP_READ_ADC_SYNC = 0x4,       //value: pwm (2 bytes), settle periods (1 byte)
+} CUSTOM_HID_BATCH_OPERATIONS;
+
+typedef enum
+{
+    BATCH_STATUS_OK = 0x00,
+    BATCH_STATUS_BAD_OPERATION = 0x01,  //unknown operation or wrong length, stopped there
+    BATCH_STATUS_TRUNCATED = 0x02,      //operation ran past the end of the report
+    BATCH_STATUS_REPLY_FULL = 0x03,     //no room left for more results, stopped there
+} CUSTOM_HID_BATCH_STATUS;
+
+#define BATCH_REPLY_HEADER_SIZE 3
+
 /*********************************************************************
 * Function: void APP_DeviceCustomHIDInitialize(void);
 *
@@ -65,3 +226,5 @@ void APP_DeviceCustomHIDStart();
 *
 ********************************************************************/
 void APP_DeviceCustomHIDTasks();
+
+#endif //APP_DEVICE_CUSTOM_HID_H
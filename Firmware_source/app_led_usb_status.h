@@ -27,8 +27,8 @@
 *           A fast blink indicates successfully connected.  A slow pulse
 *           indicates that it is still in the process of connecting.  Off
 *           indicates thta it is not attached to the bus or the bus is suspended.
-*           This should be called on every start of frame packet reception and
-*           if a suspend/resume event occurs.
+*           This should be called every 1ms from the scheduler and if a
+*           suspend/resume event occurs.
 *
 * PreCondition: LEDs are enabled.
 *
@@ -0,0 +1,117 @@
+/*******************************************************************************
+
+    Author:  Gaurav Singh
+    website: www.circuitvalley.com 
+    Created on October 28, 2017
+    
+    This file is part of Circuitvalley USB HID Bootloader.
+
+    Circuitvalley USB HID Bootloader is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Circuitvalley USB HID Bootloader is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Circuitvalley USB HID Bootloader.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+#include <xc.h>
+#include <stdint.h>
+
+#include "boot_request.h"
+#include "fixed_address_memory.h"
+#include "usb.h"
+
+#define BOOT_CYCLES_PER_MS  12000   //_delay() cycles in 1ms at 12 MIPS
+
+//Kept across warm resets: the C startup code leaves them alone and the
+//bootloader reads them before its own startup code runs
+persistent uint8_t bootRequest @ BOOT_REQUEST_ADDRESS;
+persistent uint8_t bootRequestCheck @ (BOOT_REQUEST_ADDRESS + 1);
+
+/** PRIVATE PROTOTYPES *********************************************/
+static void BOOT_SetRequest(uint8_t request);
+
+/*********************************************************************
+* Function: void BOOT_SetRequest(uint8_t request);
+*
+* Overview: Stores a request and its complement for the bootloader.
+*
+* PreCondition: none
+*
+* Input: uint8_t request - BOOT_REQUEST_ value
+*
+* Output: None
+*
+********************************************************************/
+static void BOOT_SetRequest(uint8_t request)
+{
+    bootRequest = request;
+    bootRequestCheck = (uint8_t)~request;
+}
+
+/*********************************************************************
+* Function: void BOOT_RequestFastBoot(void);
+*
+* Overview: Leaves a fast boot request, so that any following warm reset
+*           (WDT, stack overflow, RESET instruction) goes straight back into
+*           the application, without the bootloader's sw2 settle delay and
+*           pin check.  Power on and brown out resets still boot normally.
+*           Has no effect unless the bootloader was built with
+*           ENABLE_WARM_RESET_REQUEST.
+*
+* PreCondition: none
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+void BOOT_RequestFastBoot(void)
+{
+    BOOT_SetRequest(BOOT_REQUEST_FAST_BOOT);
+}
+
+/*********************************************************************
+* Function: void BOOT_EnterBootloader(void);
+*
+* Overview: Detaches from the USB host, waits BOOT_DETACH_TIME_MS and
+*           enters the bootloader, which then enumerates as the HID
+*           bootloader without sw2 being held.  Never returns.
+*
+* PreCondition: none
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+void BOOT_EnterBootloader(void)
+{
+    uint8_t i;
+
+    INTCONbits.GIE = 0;
+    USBDeviceDetach();
+
+    for(i = 0; i < BOOT_DETACH_TIME_MS; i++)
+    {
+        _delay(BOOT_CYCLES_PER_MS);
+    }
+
+#if defined(BOOT_USE_WARM_RESET_REQUEST)
+    BOOT_SetRequest(BOOT_REQUEST_ENTER_BOOTLOADER);
+    RESET();
+#else
+    //BootMain() clears INTCON and the stack pointer itself
+    #asm
+        movlp (BOOT_SOFT_ENTRY_ADDRESS >> 8)
+        goto (BOOT_SOFT_ENTRY_ADDRESS & 0x7FF)
+    #endasm
+#endif
+}
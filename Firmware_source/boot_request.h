@@ -0,0 +1,83 @@
+/*******************************************************************************
+
+    Author:  Gaurav Singh
+    website: www.circuitvalley.com 
+    Created on October 28, 2017
+    
+    This file is part of Circuitvalley USB HID Bootloader.
+
+    Circuitvalley USB HID Bootloader is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Circuitvalley USB HID Bootloader is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Circuitvalley USB HID Bootloader.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+#ifndef BOOT_REQUEST_H
+#define BOOT_REQUEST_H
+
+#include <stdint.h>
+
+//Request values understood by the bootloader at the next warm reset, see
+//USB_Bootloader_source/src/BootPIC16F145x.h
+#define BOOT_REQUEST_NONE               0x00
+#define BOOT_REQUEST_FAST_BOOT          0xA5
+#define BOOT_REQUEST_ENTER_BOOTLOADER   0x5A
+
+//Time the device stays detached before the reset, so the host sees a clean
+//unplug/replug like with ResetDeviceCleanly() in the bootloader (100ms+)
+#define BOOT_DETACH_TIME_MS             200
+
+//Uncomment only if the bootloader was built with ENABLE_WARM_RESET_REQUEST
+//(USB_Bootloader_source/src/usb_config.h).  BOOT_EnterBootloader() then leaves
+//an enter bootloader request and resets.  Otherwise it jumps to the
+//bootloader's software entry point, which every bootloader build has.
+//#define BOOT_USE_WARM_RESET_REQUEST
+
+//BootMain() in the bootloader, see BOOTLOADER_ABSOLUTE_ENTRY_ADDRESS there
+#define BOOT_SOFT_ENTRY_ADDRESS         0x001C
+
+/*********************************************************************
+* Function: void BOOT_RequestFastBoot(void);
+*
+* Overview: Leaves a fast boot request, so that any following warm reset
+*           (WDT, stack overflow, RESET instruction) goes straight back into
+*           the application, without the bootloader's sw2 settle delay and
+*           pin check.  Power on and brown out resets still boot normally.
+*           Has no effect unless the bootloader was built with
+*           ENABLE_WARM_RESET_REQUEST.
+*
+* PreCondition: none
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+void BOOT_RequestFastBoot(void);
+
+/*********************************************************************
+* Function: void BOOT_EnterBootloader(void);
+*
+* Overview: Detaches from the USB host, waits BOOT_DETACH_TIME_MS and
+*           enters the bootloader, which then enumerates as the HID
+*           bootloader without sw2 being held.  Never returns.
+*
+* PreCondition: none
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+void BOOT_EnterBootloader(void);
+
+#endif //BOOT_REQUEST_H
@@ -23,9 +23,28 @@
 #ifndef FIXED_MEMORY_ADDRESS_H
 #define FIXED_MEMORY_ADDRESS_H
 
+//Absolute placement uses the XC8 @ syntax, host builds (sim/xc.h) leave the
+//buffers wherever the compiler puts them.
+#if !defined(SIM_HOST_BUILD)
 #define FIXED_ADDRESS_MEMORY
+#endif
 
 #define HID_CUSTOM_OUT_DATA_BUFFER_ADDRESS 0x2050
 #define HID_CUSTOM_IN_DATA_BUFFER_ADDRESS 0x20A0
+#define HID_CUSTOM_OUT_ODD_DATA_BUFFER_ADDRESS 0x20F0
+#define HID_CUSTOM_IN_ODD_DATA_BUFFER_ADDRESS 0x2140
+
+//USB_USE_CDC: the 64 byte BDT and the EP0 buffers fill bank 0, what is left of
+//the dual port RAM (0x2000-0x21FF) is bank 5 and the first 32 bytes of bank 6.
+#define CDC_DATA_IN_BUFFER_ADDRESS 0x2190
+#define CDC_DATA_OUT_BUFFER_ADDRESS 0x21E0
+
+//USB_USE_HID_STREAM: a single IN buffer, an interrupt endpoint only moves one
+//packet per frame so it is refilled long before the next poll.
+#define HID_STREAM_IN_DATA_BUFFER_ADDRESS 0x2190
+
+//Warm reset request shared with the bootloader (must match BOOT_REQUEST_ADDRESS
+//in USB_Bootloader_source/src/BootPIC16F145x.h): last two bytes of linear RAM
+#define BOOT_REQUEST_ADDRESS 0x64E
 
 #endif //FIXED_MEMORY_ADDRESS
\ No newline at end of file
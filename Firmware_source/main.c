@@ -29,6 +29,11 @@
 
 #include "app_device_custom_hid.h"
 #include "app_led_usb_status.h"
+#if defined(USB_USE_CDC)
+#include "app_device_cdc_to_uart.h"
+#endif
+#include "boot_request.h"
+#include "scheduler.h"
 
 
 
@@ -36,6 +41,13 @@ MAIN_RETURN main(void)
 {
     SYSTEM_Initialize(SYSTEM_STATE_USB_START);
 
+    //A warm reset from here on (WDT, stack overflow) comes straight back
+    //into the application, a power cycle still goes through the sw2 check.
+    BOOT_RequestFastBoot();
+
+    //The LED indicator keeps time from the Timer0 tick rather than host SOFs
+    SCHEDULER_Register(APP_LEDUpdateUSBStatus, 1);
+
     USBDeviceInit();
     USBDeviceAttach();
 
@@ -61,6 +73,9 @@ MAIN_RETURN main(void)
 
         //Application specific tasks
         APP_DeviceCustomHIDTasks();
+        #if defined(USB_USE_CDC)
+            APP_DeviceCDCEmulatorTasks();
+        #endif
 
     }//end while
 }//end main
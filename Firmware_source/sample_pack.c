@@ -0,0 +1,83 @@
+/*******************************************************************************
+
+    Author:  Gaurav Singh
+    website: www.circuitvalley.com 
+    Created on October 28, 2017
+    
+    This file is part of Circuitvalley USB HID Bootloader.
+
+    Circuitvalley USB HID Bootloader is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Circuitvalley USB HID Bootloader is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Circuitvalley USB HID Bootloader.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+#include <stdint.h>
+
+#include "sample_pack.h"
+
+/*********************************************************************
+* Function: void SAMPLE_PackHeader(uint8_t* report, uint8_t type, uint8_t sequence, uint16_t timestamp);
+*
+* Overview: Writes the packed report header.
+*
+* PreCondition: none
+*
+* Input: uint8_t* report - start of the 64 byte report
+*        uint8_t type - report type byte
+*        uint8_t sequence - report sequence counter
+*        uint16_t timestamp - conversion index of the first sample
+*
+* Output: None
+*
+********************************************************************/
+void SAMPLE_PackHeader(uint8_t* report, uint8_t type, uint8_t sequence, uint16_t timestamp)
+{
+    report[0] = type;
+    report[1] = sequence;
+    report[2] = timestamp;
+    report[3] = timestamp >> 8;
+}
+
+/*********************************************************************
+* Function: void SAMPLE_PackGroup(uint8_t* dest, const uint16_t* samples);
+*
+* Overview: Packs four 10-bit samples into five bytes.  The low bytes go
+*           out unshifted and only the top two bits of each sample are
+*           merged, which keeps the shifting cheap on this core.
+*
+* PreCondition: none
+*
+* Input: uint8_t* dest - five bytes of report space
+*        const uint16_t* samples - four right adjusted 10-bit samples
+*
+* Output: None
+*
+********************************************************************/
+void SAMPLE_PackGroup(uint8_t* dest, const uint16_t* samples)
+{
+    uint8_t high;
+
+    dest[0] = samples[0];
+    dest[1] = samples[1];
+    dest[2] = samples[2];
+    dest[3] = samples[3];
+
+    high = (samples[3] >> 8) & 0x03;
+    high <<= 2;
+    high |= (samples[2] >> 8) & 0x03;
+    high <<= 2;
+    high |= (samples[1] >> 8) & 0x03;
+    high <<= 2;
+    high |= (samples[0] >> 8) & 0x03;
+    dest[4] = high;
+}
@@ -0,0 +1,79 @@
+/*******************************************************************************
+
+    Author:  Gaurav Singh
+    website: www.circuitvalley.com 
+    Created on October 28, 2017
+    
+    This file is part of Circuitvalley USB HID Bootloader.
+
+    Circuitvalley USB HID Bootloader is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Circuitvalley USB HID Bootloader is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Circuitvalley USB HID Bootloader.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+#ifndef SAMPLE_PACK_H
+#define SAMPLE_PACK_H
+
+#include <stdint.h>
+
+/*** Packed Sample Report Definitions ********************************/
+//A packed report is a 4 byte header followed by groups of four 10-bit
+//samples stored in five bytes:
+//
+//  [0] report type (command byte echoed to the host)
+//  [1] sequence counter, incremented once per report
+//  [2] timestamp low byte  \ conversion index of the first sample in the
+//  [3] timestamp high byte / report, counted in sample periods
+//  [4..63] 12 groups of:
+//      byte 0..3 - low 8 bits of samples 0..3
+//      byte 4    - bits 9:8 of sample 0 in bits 1:0, sample 1 in bits 3:2,
+//                  sample 2 in bits 5:4 and sample 3 in bits 7:6
+#define SAMPLE_PACK_HEADER_SIZE         4
+#define SAMPLE_PACK_GROUP_SAMPLES       4
+#define SAMPLE_PACK_GROUP_SIZE          5
+#define SAMPLE_PACK_GROUPS_PER_REPORT   ((64 - SAMPLE_PACK_HEADER_SIZE) / SAMPLE_PACK_GROUP_SIZE)
+#define SAMPLE_PACK_SAMPLES_PER_REPORT  (SAMPLE_PACK_GROUPS_PER_REPORT * SAMPLE_PACK_GROUP_SAMPLES)
+
+/*********************************************************************
+* Function: void SAMPLE_PackHeader(uint8_t* report, uint8_t type, uint8_t sequence, uint16_t timestamp);
+*
+* Overview: Writes the packed report header.
+*
+* PreCondition: none
+*
+* Input: uint8_t* report - start of the 64 byte report
+*        uint8_t type - report type byte
+*        uint8_t sequence - report sequence counter
+*        uint16_t timestamp - conversion index of the first sample
+*
+* Output: None
+*
+********************************************************************/
+void SAMPLE_PackHeader(uint8_t* report, uint8_t type, uint8_t sequence, uint16_t timestamp);
+
+/*********************************************************************
+* Function: void SAMPLE_PackGroup(uint8_t* dest, const uint16_t* samples);
+*
+* Overview: Packs four 10-bit samples into five bytes.
+*
+* PreCondition: none
+*
+* Input: uint8_t* dest - five bytes of report space
+*        const uint16_t* samples - four right adjusted 10-bit samples
+*
+* Output: None
+*
+********************************************************************/
+void SAMPLE_PackGroup(uint8_t* dest, const uint16_t* samples);
+
+#endif //SAMPLE_PACK_H
@@ -0,0 +1,253 @@
+/*******************************************************************************
+
+    Author:  Gaurav Singh
+    website: www.circuitvalley.com 
+    Created on October 28, 2017
+    
+    This file is part of Circuitvalley USB HID Bootloader.
+
+    Circuitvalley USB HID Bootloader is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Circuitvalley USB HID Bootloader is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Circuitvalley USB HID Bootloader.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "scheduler.h"
+
+//Timer0 runs from Fosc/4 (12MHz) through the 1:64 prescaler, 187.5 counts per
+//ms.  The reload is added to TMR0 so interrupt latency does not accumulate,
+//but writing TMR0 also clears the prescaler, dropping 0-63 cycles per tick.
+//187 counts (11968 cycles) plus that residue keeps the tick within about
+//0.3% of 1ms.
+#define SCHEDULER_TIMER0_PRESCALE_1_64  0b101
+#define SCHEDULER_TIMER0_COUNTS_PER_MS  187
+#define SCHEDULER_TIMER0_RELOAD         ((uint8_t)(256 - SCHEDULER_TIMER0_COUNTS_PER_MS))
+
+#define SCHEDULER_PERIOD_MAX            0x7FFF
+
+typedef struct
+{
+    SCHEDULER_TASK_FUNCTION function;
+    uint16_t period;
+    uint16_t deadline;
+    uint16_t maxLateness;
+    uint16_t overruns;
+} SCHEDULER_TASK;
+
+static volatile uint16_t ticks;
+static SCHEDULER_TASK tasks[SCHEDULER_MAX_TASKS];
+static uint8_t taskCount;
+
+/*********************************************************************
+* Function: void SCHEDULER_Initialize(void);
+*
+* Overview: Starts the Timer0 1ms tick and clears the task list.
+*
+* PreCondition: none
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+void SCHEDULER_Initialize(void)
+{
+    taskCount = 0;
+    ticks = 0;
+
+    OPTION_REGbits.TMR0CS = 0;      //Fosc/4
+    OPTION_REGbits.PSA = 0;         //prescaler assigned to Timer0
+    OPTION_REGbits.PS = SCHEDULER_TIMER0_PRESCALE_1_64;
+
+    TMR0 = SCHEDULER_TIMER0_RELOAD;
+    INTCONbits.TMR0IF = 0;
+    INTCONbits.TMR0IE = 1;
+}
+
+/*********************************************************************
+* Function: uint8_t SCHEDULER_Register(SCHEDULER_TASK_FUNCTION function, uint16_t period);
+*
+* Overview: Adds a periodic task.  Its first run is one period from now.
+*
+* PreCondition: SCHEDULER_Initialize() was called
+*
+* Input: SCHEDULER_TASK_FUNCTION function - the task
+*        uint16_t period - period in ms, 1 to 32767
+*
+* Output: uint8_t - task id, or SCHEDULER_INVALID_TASK when the list is
+*                   full or the period is out of range
+*
+********************************************************************/
+uint8_t SCHEDULER_Register(SCHEDULER_TASK_FUNCTION function, uint16_t period)
+{
+    SCHEDULER_TASK* task;
+
+    if((taskCount >= SCHEDULER_MAX_TASKS) || (period == 0) || (period > SCHEDULER_PERIOD_MAX))
+    {
+        return SCHEDULER_INVALID_TASK;
+    }
+
+    task = &tasks[taskCount];
+    task->function = function;
+    task->period = period;
+    task->deadline = SCHEDULER_Milliseconds() + period;
+    task->maxLateness = 0;
+    task->overruns = 0;
+
+    return taskCount++;
+}
+
+/*********************************************************************
+* Function: void SCHEDULER_Tasks(void);
+*
+* Overview: Runs every task whose deadline has come.  Call it from the
+*           main loop.
+*
+* PreCondition: SCHEDULER_Initialize() was called
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+void SCHEDULER_Tasks(void)
+{
+    uint8_t i;
+    uint16_t now;
+    uint16_t lateness;
+    SCHEDULER_TASK* task;
+
+    for(i = 0; i < taskCount; i++)
+    {
+        task = &tasks[i];
+        now = SCHEDULER_Milliseconds();
+
+        //deadlines are compared modulo 2^16, periods stay under half of it
+        lateness = now - task->deadline;
+        if(lateness > SCHEDULER_PERIOD_MAX)
+        {
+            continue;   //not due yet
+        }
+
+        if(lateness > task->maxLateness)
+        {
+            task->maxLateness = lateness;
+        }
+
+        task->deadline += task->period;
+        if(lateness >= task->period)
+        {
+            //missed at least one run, start again from now
+            if(task->overruns != 0xFFFF)
+            {
+                task->overruns++;
+            }
+            task->deadline = now + task->period;
+        }
+
+        task->function();
+    }
+}
+
+/*********************************************************************
+* Function: uint16_t SCHEDULER_Milliseconds(void);
+*
+* Overview: Returns the tick count, wrapping every 65.536s.
+*
+* PreCondition: SCHEDULER_Initialize() was called
+*
+* Input: None
+*
+* Output: uint16_t - milliseconds since SCHEDULER_Initialize()
+*
+********************************************************************/
+uint16_t SCHEDULER_Milliseconds(void)
+{
+    uint16_t now;
+
+    //the interrupt can change the count between the two byte reads
+    do
+    {
+        now = ticks;
+    } while(now != ticks);
+
+    return now;
+}
+
+/*********************************************************************
+* Function: uint16_t SCHEDULER_MaxLateness(uint8_t task);
+*
+* Overview: Returns the longest time a task started after its deadline.
+*
+* PreCondition: task was returned by SCHEDULER_Register()
+*
+* Input: uint8_t task - task id
+*
+* Output: uint16_t - worst lateness in ms
+*
+********************************************************************/
+uint16_t SCHEDULER_MaxLateness(uint8_t task)
+{
+    if(task >= taskCount)
+    {
+        return 0;
+    }
+    return tasks[task].maxLateness;
+}
+
+/*********************************************************************
+* Function: uint16_t SCHEDULER_Overruns(uint8_t task);
+*
+* Overview: Returns how many times a task was a whole period or more late,
+*           i.e. missed at least one run.  Missed runs are dropped rather
+*           than run back-to-back.
+*
+* PreCondition: task was returned by SCHEDULER_Register()
+*
+* Input: uint8_t task - task id
+*
+* Output: uint16_t - number of overruns, saturating at 0xFFFF
+*
+********************************************************************/
+uint16_t SCHEDULER_Overruns(uint8_t task)
+{
+    if(task >= taskCount)
+    {
+        return 0;
+    }
+    return tasks[task].overruns;
+}
+
+/*********************************************************************
+* Function: void SCHEDULER_InterruptHandler(void);
+*
+* Overview: Advances the tick.  Called from the interrupt vector on a
+*           Timer0 overflow.
+*
+* PreCondition: SCHEDULER_Initialize() was called
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+void SCHEDULER_InterruptHandler(void)
+{
+    TMR0 += SCHEDULER_TIMER0_RELOAD;
+    INTCONbits.TMR0IF = 0;
+    ticks++;
+}
@@ -0,0 +1,146 @@
+/*******************************************************************************
+
+    Author:  Gaurav Singh
+    website: www.circuitvalley.com 
+    Created on October 28, 2017
+    
+    This file is part of Circuitvalley USB HID Bootloader.
+
+    Circuitvalley USB HID Bootloader is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Circuitvalley USB HID Bootloader is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Circuitvalley USB HID Bootloader.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*** Cooperative Tick Scheduler ****************************************/
+//Timer0 provides a 1ms tick that runs whether or not the host is sending
+//SOFs (suspended, detached or not yet enumerated).  Periodic tasks are
+//registered with a period in ticks and are run from the main loop by
+//SCHEDULER_Tasks(), never from the interrupt, so they may take their time;
+//a task that starts late is tracked against its deadline instead.
+#define SCHEDULER_MAX_TASKS         4
+#define SCHEDULER_INVALID_TASK      0xFF
+
+typedef void (*SCHEDULER_TASK_FUNCTION)(void);
+
+/*********************************************************************
+* Function: void SCHEDULER_Initialize(void);
+*
+* Overview: Starts the Timer0 1ms tick and clears the task list.
+*
+* PreCondition: none
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+void SCHEDULER_Initialize(void);
+
+/*********************************************************************
+* Function: uint8_t SCHEDULER_Register(SCHEDULER_TASK_FUNCTION function, uint16_t period);
+*
+* Overview: Adds a periodic task.  Its first run is one period from now.
+*
+* PreCondition: SCHEDULER_Initialize() was called
+*
+* Input: SCHEDULER_TASK_FUNCTION function - the task
+*        uint16_t period - period in ms, 1 to 32767
+*
+* Output: uint8_t - task id, or SCHEDULER_INVALID_TASK when the list is
+*                   full or the period is out of range
+*
+********************************************************************/
+uint8_t SCHEDULER_Register(SCHEDULER_TASK_FUNCTION function, uint16_t period);
+
+/*********************************************************************
+* Function: void SCHEDULER_Tasks(void);
+*
+* Overview: Runs every task whose deadline has come.  Call it from the
+*           main loop.
+*
+* PreCondition: SCHEDULER_Initialize() was called
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+void SCHEDULER_Tasks(void);
+
+/*********************************************************************
+* Function: uint16_t SCHEDULER_Milliseconds(void);
+*
+* Overview: Returns the tick count, wrapping every 65.536s.
+*
+* PreCondition: SCHEDULER_Initialize() was called
+*
+* Input: None
+*
+* Output: uint16_t - milliseconds since SCHEDULER_Initialize()
+*
+********************************************************************/
+uint16_t SCHEDULER_Milliseconds(void);
+
+/*********************************************************************
+* Function: uint16_t SCHEDULER_MaxLateness(uint8_t task);
+*
+* Overview: Returns the longest time a task started after its deadline.
+*
+* PreCondition: task was returned by SCHEDULER_Register()
+*
+* Input: uint8_t task - task id
+*
+* Output: uint16_t - worst lateness in ms
+*
+********************************************************************/
+uint16_t SCHEDULER_MaxLateness(uint8_t task);
+
+/*********************************************************************
+* Function: uint16_t SCHEDULER_Overruns(uint8_t task);
+*
+* Overview: Returns how many times a task was a whole period or more late,
+*           i.e. missed at least one run.  Missed runs are dropped rather
+*           than run back-to-back.
+*
+* PreCondition: task was returned by SCHEDULER_Register()
+*
+* Input: uint8_t task - task id
+*
+* Output: uint16_t - number of overruns, saturating at 0xFFFF
+*
+********************************************************************/
+uint16_t SCHEDULER_Overruns(uint8_t task);
+
+/*********************************************************************
+* Function: void SCHEDULER_InterruptHandler(void);
+*
+* Overview: Advances the tick.  Called from the interrupt vector on a
+*           Timer0 overflow.
+*
+* PreCondition: SCHEDULER_Initialize() was called
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+void SCHEDULER_InterruptHandler(void);
+
+#endif //SCHEDULER_H
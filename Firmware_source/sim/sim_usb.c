@@ -0,0 +1,631 @@
+/*******************************************************************************
+
+    Author:  Gaurav Singh
+    website: www.circuitvalley.com
+    Created on October 28, 2017
+
+    This file is part of Circuitvalley USB HID Bootloader.
+
+    Circuitvalley USB HID Bootloader is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Circuitvalley USB HID Bootloader is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Circuitvalley USB HID Bootloader.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <xc.h>
+
+#include "sim_usb.h"
+#include "usb_device_local.h"
+#include "usb_device_hid.h"
+#include "usb_profile.h"
+
+#define SIM_USB_ENDPOINTS       (USB_MAX_EP_NUMBER + 1)
+#define SIM_USB_BUFFERS         16      //USB RAM buffers the stack can point a descriptor at
+#define SIM_USB_NAK_RETRIES     100     //frames a control transfer retries a NAKed stage
+#define SIM_USB_MAX_PACKET      64
+
+#define SIM_USB_OUT             0
+#define SIM_USB_IN              1
+
+/*** Device Stack State *************************************************/
+extern volatile BDT_ENTRY BDT[BDT_NUM_ENTRIES];
+
+/*** SIE State **********************************************************/
+//Buffer handed to ConvertToPhysicalAddress(), the index + 1 is the address
+//written into the descriptor (0 stays an invalid address)
+static const volatile void* simBuffer[SIM_USB_BUFFERS];
+
+//even/odd descriptor the SIE uses next, per endpoint and direction
+static uint8_t simSiePingPong[SIM_USB_ENDPOINTS][2];
+static uint8_t simPingPongResetPin;
+
+/*** Host State *********************************************************/
+static uint8_t simHostAddress;
+static uint8_t simHostToggle[SIM_USB_ENDPOINTS][2];
+
+/*********************************************************************
+* Function: uint16_t SIM_UsbPhysicalAddress(const volatile void* address);
+*
+* Overview: ConvertToPhysicalAddress() of the host build, hands out a
+*           16-bit descriptor address for a buffer.
+*
+* PreCondition: None
+*
+* Input: const volatile void* address - buffer in "USB RAM"
+*
+* Output: uint16_t - the address to write into BDT[].ADR
+*
+********************************************************************/
+uint16_t SIM_UsbPhysicalAddress(const volatile void* address)
+{
+    uint8_t i;
+
+    for(i = 0; i < SIM_USB_BUFFERS; i++)
+    {
+        if((simBuffer[i] == address) || (simBuffer[i] == NULL))
+        {
+            simBuffer[i] = address;
+            return i + 1;
+        }
+    }
+
+    //more buffers than the real dual port RAM would hold
+    abort();
+}
+
+/*********************************************************************
+* Function: void* SIM_UsbVirtualAddress(uint16_t address);
+*
+* Overview: ConvertToVirtualAddress() of the host build.
+*
+* PreCondition: None
+*
+* Input: uint16_t address - BDT[].ADR
+*
+* Output: void* - the buffer, NULL for an address never handed out
+*
+********************************************************************/
+void* SIM_UsbVirtualAddress(uint16_t address)
+{
+    if((address == 0) || (address > SIM_USB_BUFFERS))
+    {
+        return NULL;
+    }
+
+    return (void*)simBuffer[address - 1];
+}
+
+/*********************************************************************
+* Function: volatile uint8_t* SIM_UsbPingPongBufferReset(void);
+*
+* Overview: UCONbits.PPBRST of the host build.  Every write points the
+*           SIE at the even descriptor of every endpoint again, which is
+*           what holding PPBRST high does on the chip.
+*
+* PreCondition: None
+*
+* Input: None
+*
+* Output: volatile uint8_t* - the bit to write
+*
+********************************************************************/
+volatile uint8_t* SIM_UsbPingPongBufferReset(void)
+{
+    memset(simSiePingPong, 0, sizeof(simSiePingPong));
+    return &simPingPongResetPin;
+}
+
+/*********************************************************************
+* Function: static void SIM_UsbInterrupt(void);
+*
+* Overview: Raises USBIF for any enabled UIR flag and takes the interrupt
+*           like SYS_InterruptHigh() in system.c, with GIE cleared until
+*           the RETFIE.
+*
+* PreCondition: None
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+static void SIM_UsbInterrupt(void)
+{
+    if(UIR & UIE)
+    {
+        PIR2bits.USBIF = 1;
+    }
+
+    if(INTCONbits.GIE && INTCONbits.PEIE && PIE2bits.USBIE && PIR2bits.USBIF)
+    {
+        INTCONbits.GIE = 0;
+        USB_PROFILE_BEGIN(USB_PROFILE_DEVICE_TASKS);
+        USBDeviceTasks();
+        USB_PROFILE_END(USB_PROFILE_DEVICE_TASKS);
+        INTCONbits.GIE = 1;
+    }
+}
+
+/*********************************************************************
+* Function: static SIM_USB_HANDSHAKE SIM_UsbTransaction(uint8_t pid, uint8_t ep, uint8_t* data, uint8_t* length);
+*
+* Overview: One token, data and handshake phase as the SIE runs it on the
+*           descriptor its ping-pong pointer selects.
+*
+* PreCondition: None
+*
+* Input: uint8_t pid - PID_SETUP, PID_OUT or PID_IN
+*        uint8_t ep - endpoint number
+*        uint8_t* data - packet to send, or room for the IN packet
+*        uint8_t* length - packet length, receives the IN packet length
+*
+* Output: SIM_USB_HANDSHAKE - how the device answered
+*
+********************************************************************/
+static SIM_USB_HANDSHAKE SIM_UsbTransaction(uint8_t pid, uint8_t ep, uint8_t* data, uint8_t* length)
+{
+    uint8_t dir = (pid == PID_IN) ? SIM_USB_IN : SIM_USB_OUT;
+    uint8_t ppbi;
+    uint8_t uep;
+    uint8_t* buffer;
+    volatile BDT_ENTRY* bd;
+
+    //nobody answers: module off, another device, or an endpoint that is
+    //not enabled for this direction (or for SETUP)
+    if((UCONbits.USBEN == 0) || (simHostAddress != UADDR) || (ep >= SIM_USB_ENDPOINTS))
+    {
+        return SIM_USB_TIMEOUT;
+    }
+    uep = simUEP[ep];
+    if(((dir == SIM_USB_IN) && ((uep & 0x02) == 0)) || ((dir == SIM_USB_OUT) && ((uep & 0x04) == 0)))
+    {
+        return SIM_USB_TIMEOUT;
+    }
+    if((pid == PID_SETUP) && (uep & 0x08))
+    {
+        return SIM_USB_TIMEOUT;
+    }
+
+    //USTAT still holds the last transaction, or a SETUP disabled packet
+    //processing, or the CPU owns the descriptor
+    ppbi = simSiePingPong[ep][dir];
+    bd = &BDT[(ep * 4) + (dir * 2) + ppbi];
+    if(UIRbits.TRNIF || ((pid != PID_SETUP) && UCONbits.PKTDIS) || (bd->STAT.UOWN == 0))
+    {
+        return SIM_USB_NAK;
+    }
+
+    if((pid != PID_SETUP) && bd->STAT.BSTALL)
+    {
+        simUEP[ep] |= 0x01;
+        UIRbits.STALLIF = 1;
+        SIM_UsbInterrupt();
+        return SIM_USB_STALL;
+    }
+
+    buffer = SIM_UsbVirtualAddress(bd->ADR);
+    if(dir == SIM_USB_OUT)
+    {
+        if((*length > bd->CNT) || (buffer == NULL))
+        {
+            return SIM_USB_TIMEOUT;
+        }
+
+        //data toggle synchronization, a SETUP is always DATA0 and always taken
+        if((pid != PID_SETUP) && bd->STAT.DTSEN && (bd->STAT.DTS != simHostToggle[ep][SIM_USB_OUT]))
+        {
+            simHostToggle[ep][SIM_USB_OUT] ^= 1;
+            return SIM_USB_TOGGLE_ERROR;
+        }
+
+        memcpy(buffer, data, *length);
+        bd->CNT = *length;
+        bd->STAT.Val = (bd->STAT.Val & _DTSMASK) | (pid << 2);
+        simHostToggle[ep][SIM_USB_OUT] ^= 1;
+    }
+    else
+    {
+        if((bd->CNT > SIM_USB_MAX_PACKET) || ((bd->CNT != 0) && (buffer == NULL)))
+        {
+            return SIM_USB_TIMEOUT;
+        }
+
+        //the device is done with the packet once the host ACKs it, even if
+        //the host drops it for the wrong toggle
+        bd->STAT.Val = (bd->STAT.Val & _DTSMASK) | (pid << 2);
+        if(bd->STAT.DTS != simHostToggle[ep][SIM_USB_IN])
+        {
+            simSiePingPong[ep][dir] ^= 1;
+            USTAT = (ep << 3) | (dir << 2) | (ppbi << 1);
+            UIRbits.TRNIF = 1;
+            SIM_UsbInterrupt();
+            return SIM_USB_TOGGLE_ERROR;
+        }
+
+        *length = bd->CNT;
+        memcpy(data, buffer, bd->CNT);
+        simHostToggle[ep][SIM_USB_IN] ^= 1;
+    }
+
+    simSiePingPong[ep][dir] ^= 1;
+    USTAT = (ep << 3) | (dir << 2) | (ppbi << 1);
+    if(pid == PID_SETUP)
+    {
+        UCONbits.PKTDIS = 1;
+        simHostToggle[0][SIM_USB_OUT] = 1;
+        simHostToggle[0][SIM_USB_IN] = 1;
+    }
+    UIRbits.TRNIF = 1;
+    SIM_UsbInterrupt();
+
+    return SIM_USB_ACK;
+}
+
+/*********************************************************************
+* Function: void SIM_UsbBusReset(void);
+*
+* Overview: Resets the bus: the host goes back to address 0 and DATA0 on
+*           every endpoint, and the stack sees URSTIF.
+*
+* PreCondition: USBDeviceInit() and USBDeviceAttach() were called.
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+void SIM_UsbBusReset(void)
+{
+    simHostAddress = 0;
+    memset(simHostToggle, 0, sizeof(simHostToggle));
+
+    UCONbits.SE0 = 1;
+    UIRbits.URSTIF = 1;
+    SIM_UsbInterrupt();
+    UCONbits.SE0 = 0;
+}
+
+/*********************************************************************
+* Function: void SIM_UsbStartOfFrame(void);
+*
+* Overview: Sends a start of frame, the 1ms tick of the stack.
+*
+* PreCondition: None
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+void SIM_UsbStartOfFrame(void)
+{
+    UIRbits.SOFIF = 1;
+    SIM_UsbInterrupt();
+}
+
+/*********************************************************************
+* Function: void SIM_UsbSuspend(void);
+*
+* Overview: Idles the bus long enough for IDLEIF, the stack suspends.
+*
+* PreCondition: None
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+void SIM_UsbSuspend(void)
+{
+    UIRbits.IDLEIF = 1;
+    SIM_UsbInterrupt();
+}
+
+/*********************************************************************
+* Function: void SIM_UsbResume(void);
+*
+* Overview: Resumes bus activity, the stack sees ACTVIF and wakes up.
+*
+* PreCondition: None
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+void SIM_UsbResume(void)
+{
+    UIRbits.ACTVIF = 1;
+    SIM_UsbInterrupt();
+}
+
+/*********************************************************************
+* Function: SIM_USB_HANDSHAKE SIM_UsbHostSetup(const uint8_t* setup);
+*
+* Overview: Sends the 8 byte SETUP packet of a control transfer to
+*           endpoint 0.
+*
+* PreCondition: None
+*
+* Input: const uint8_t* setup - the SETUP packet
+*
+* Output: SIM_USB_HANDSHAKE - how the device answered
+*
+********************************************************************/
+SIM_USB_HANDSHAKE SIM_UsbHostSetup(const uint8_t* setup)
+{
+    uint8_t packet[8];
+    uint8_t length = sizeof(packet);
+
+    memcpy(packet, setup, sizeof(packet));
+    return SIM_UsbTransaction(PID_SETUP, 0, packet, &length);
+}
+
+/*********************************************************************
+* Function: SIM_USB_HANDSHAKE SIM_UsbHostOut(uint8_t ep, const uint8_t* data, uint8_t length);
+*
+* Overview: Sends one OUT packet, with the host's data toggle of the
+*           endpoint.
+*
+* PreCondition: None
+*
+* Input: uint8_t ep - endpoint number
+*        const uint8_t* data - packet to send
+*        uint8_t length - packet length
+*
+* Output: SIM_USB_HANDSHAKE - how the device answered
+*
+********************************************************************/
+SIM_USB_HANDSHAKE SIM_UsbHostOut(uint8_t ep, const uint8_t* data, uint8_t length)
+{
+    uint8_t packet[SIM_USB_MAX_PACKET];
+
+    if(length > sizeof(packet))
+    {
+        return SIM_USB_TIMEOUT;
+    }
+
+    memcpy(packet, data, length);
+    return SIM_UsbTransaction(PID_OUT, ep, packet, &length);
+}
+
+/*********************************************************************
+* Function: SIM_USB_HANDSHAKE SIM_UsbHostIn(uint8_t ep, uint8_t* data, uint8_t* length);
+*
+* Overview: Reads one IN packet.
+*
+* PreCondition: None
+*
+* Input: uint8_t ep - endpoint number
+*        uint8_t* data - receives the packet, 64 bytes of room
+*        uint8_t* length - receives the packet length
+*
+* Output: SIM_USB_HANDSHAKE - how the device answered, the data is only
+*                             valid for SIM_USB_ACK
+*
+********************************************************************/
+SIM_USB_HANDSHAKE SIM_UsbHostIn(uint8_t ep, uint8_t* data, uint8_t* length)
+{
+    *length = 0;
+    return SIM_UsbTransaction(PID_IN, ep, data, length);
+}
+
+/*********************************************************************
+* Function: static SIM_USB_HANDSHAKE SIM_UsbControlStage(uint8_t pid, uint8_t* data, uint8_t* length);
+*
+* Overview: One data or status stage packet on endpoint 0, retried once
+*           per frame while the device NAKs it.
+*
+* PreCondition: None
+*
+* Input: uint8_t pid - PID_OUT or PID_IN
+*        uint8_t* data - packet to send, or room for the IN packet
+*        uint8_t* length - packet length, receives the IN packet length
+*
+* Output: SIM_USB_HANDSHAKE - how the device answered
+*
+********************************************************************/
+static SIM_USB_HANDSHAKE SIM_UsbControlStage(uint8_t pid, uint8_t* data, uint8_t* length)
+{
+    uint8_t retries;
+    uint8_t sent = *length;
+    SIM_USB_HANDSHAKE handshake = SIM_USB_NAK;
+
+    for(retries = 0; (retries < SIM_USB_NAK_RETRIES) && (handshake == SIM_USB_NAK); retries++)
+    {
+        *length = sent;
+        handshake = SIM_UsbTransaction(pid, 0, data, length);
+        if(handshake == SIM_USB_NAK)
+        {
+            SIM_UsbStartOfFrame();
+        }
+    }
+
+    return handshake;
+}
+
+/*********************************************************************
+* Function: bool SIM_UsbControlRead(const uint8_t* setup, uint8_t* data, uint16_t* length);
+*
+* Overview: Runs a control read: the SETUP stage, IN data packets until a
+*           short one or wLength bytes, and the OUT status stage.
+*
+* PreCondition: None
+*
+* Input: const uint8_t* setup - the SETUP packet
+*        uint8_t* data - receives the data, wLength bytes of room
+*        uint16_t* length - receives the number of bytes read
+*
+* Output: bool - true if every stage was ACKed
+*
+********************************************************************/
+bool SIM_UsbControlRead(const uint8_t* setup, uint8_t* data, uint16_t* length)
+{
+    uint16_t wLength = setup[6] | (setup[7] << 8);
+    uint8_t packet[SIM_USB_MAX_PACKET];
+    uint8_t packetLength;
+
+    *length = 0;
+    if(SIM_UsbHostSetup(setup) != SIM_USB_ACK)
+    {
+        return false;
+    }
+
+    while(*length < wLength)
+    {
+        packetLength = 0;
+        if(SIM_UsbControlStage(PID_IN, packet, &packetLength) != SIM_USB_ACK)
+        {
+            return false;
+        }
+        if(packetLength > (wLength - *length))
+        {
+            return false;
+        }
+
+        memcpy(&data[*length], packet, packetLength);
+        *length += packetLength;
+        if(packetLength < USB_EP0_BUFF_SIZE)
+        {
+            break;
+        }
+    }
+
+    packetLength = 0;
+    return (SIM_UsbControlStage(PID_OUT, packet, &packetLength) == SIM_USB_ACK);
+}
+
+/*********************************************************************
+* Function: bool SIM_UsbControlWrite(const uint8_t* setup, const uint8_t* data);
+*
+* Overview: Runs a control write or a control transfer without data: the
+*           SETUP stage, wLength bytes in OUT packets and the IN status
+*           stage.  A SET_ADDRESS, SET_CONFIGURATION or CLEAR_FEATURE
+*           (ENDPOINT_HALT) takes effect on the host side once the status
+*           stage is through.
+*
+* PreCondition: None
+*
+* Input: const uint8_t* setup - the SETUP packet
+*        const uint8_t* data - wLength bytes to send
+*
+* Output: bool - true if every stage was ACKed
+*
+********************************************************************/
+bool SIM_UsbControlWrite(const uint8_t* setup, const uint8_t* data)
+{
+    uint16_t wLength = setup[6] | (setup[7] << 8);
+    uint16_t sent = 0;
+    uint8_t packet[SIM_USB_MAX_PACKET];
+    uint8_t packetLength;
+
+    if(SIM_UsbHostSetup(setup) != SIM_USB_ACK)
+    {
+        return false;
+    }
+
+    while(sent < wLength)
+    {
+        packetLength = ((wLength - sent) > USB_EP0_BUFF_SIZE) ? USB_EP0_BUFF_SIZE : (wLength - sent);
+        memcpy(packet, &data[sent], packetLength);
+        if(SIM_UsbControlStage(PID_OUT, packet, &packetLength) != SIM_USB_ACK)
+        {
+            return false;
+        }
+        sent += packetLength;
+    }
+
+    packetLength = 0;
+    if(SIM_UsbControlStage(PID_IN, packet, &packetLength) != SIM_USB_ACK)
+    {
+        return false;
+    }
+
+    if(setup[0] == (USB_SETUP_HOST_TO_DEVICE | USB_SETUP_TYPE_STANDARD | USB_SETUP_RECIPIENT_DEVICE))
+    {
+        if(setup[1] == USB_REQUEST_SET_ADDRESS)
+        {
+            simHostAddress = setup[2];
+        }
+        else if(setup[1] == USB_REQUEST_SET_CONFIGURATION)
+        {
+            memset(&simHostToggle[1], 0, sizeof(simHostToggle) - sizeof(simHostToggle[0]));
+        }
+    }
+    else if((setup[0] == (USB_SETUP_HOST_TO_DEVICE | USB_SETUP_TYPE_STANDARD | USB_SETUP_RECIPIENT_ENDPOINT))
+         && (setup[1] == USB_REQUEST_CLEAR_FEATURE) && (setup[2] == USB_FEATURE_ENDPOINT_HALT)
+         && ((setup[4] & 0x0F) < SIM_USB_ENDPOINTS))
+    {
+        simHostToggle[setup[4] & 0x0F][setup[4] >> 7] = 0;
+    }
+
+    return true;
+}
+
+/*********************************************************************
+* Function: bool SIM_UsbEnumerate(void);
+*
+* Overview: Resets the bus and enumerates the device like a host HID
+*           driver: device descriptor, SET_ADDRESS to SIM_USB_ADDRESS,
+*           configuration descriptor, SET_CONFIGURATION 1, then the HID
+*           report descriptor and SET_IDLE.
+*
+* PreCondition: USBDeviceInit() and USBDeviceAttach() were called.
+*
+* Input: None
+*
+* Output: bool - true if every request went through and the device is in
+*                the CONFIGURED_STATE
+*
+********************************************************************/
+bool SIM_UsbEnumerate(void)
+{
+    static const uint8_t getDevice[8] = {0x80, USB_REQUEST_GET_DESCRIPTOR, 0, USB_DESCRIPTOR_DEVICE, 0, 0, 18, 0};
+    static const uint8_t setAddress[8] = {0x00, USB_REQUEST_SET_ADDRESS, SIM_USB_ADDRESS, 0, 0, 0, 0, 0};
+    static const uint8_t getConfiguration[8] = {0x80, USB_REQUEST_GET_DESCRIPTOR, 0, USB_DESCRIPTOR_CONFIGURATION, 0, 0, 0xFF, 0};
+    static const uint8_t setConfiguration[8] = {0x00, USB_REQUEST_SET_CONFIGURATION, 1, 0, 0, 0, 0, 0};
+    static const uint8_t getReport[8] = {0x81, USB_REQUEST_GET_DESCRIPTOR, 0, DSC_RPT, HID_INTF_ID, 0, HID_RPT01_SIZE, 0};
+    static const uint8_t setIdle[8] = {0x21, SET_IDLE, 0, 0, HID_INTF_ID, 0, 0, 0};
+    uint8_t descriptor[255];
+    uint16_t length;
+
+    SIM_UsbBusReset();
+    if(!SIM_UsbControlRead(getDevice, descriptor, &length) || (length != 18) || (descriptor[1] != USB_DESCRIPTOR_DEVICE))
+    {
+        return false;
+    }
+    if(!SIM_UsbControlWrite(setAddress, NULL) || (USBGetDeviceState() != ADDRESS_STATE))
+    {
+        return false;
+    }
+    if(!SIM_UsbControlRead(getConfiguration, descriptor, &length) || (length != (descriptor[2] | (descriptor[3] << 8))))
+    {
+        return false;
+    }
+    if(!SIM_UsbControlWrite(setConfiguration, NULL) || (USBGetDeviceState() != CONFIGURED_STATE))
+    {
+        return false;
+    }
+    if(!SIM_UsbControlRead(getReport, descriptor, &length) || (length != HID_RPT01_SIZE))
+    {
+        return false;
+    }
+
+    return SIM_UsbControlWrite(setIdle, NULL);
+}
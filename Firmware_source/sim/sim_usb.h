@@ -0,0 +1,223 @@
+/*******************************************************************************
+
+    Author:  Gaurav Singh
+    website: www.circuitvalley.com
+    Created on October 28, 2017
+
+    This file is part of Circuitvalley USB HID Bootloader.
+
+    Circuitvalley USB HID Bootloader is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Circuitvalley USB HID Bootloader is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Circuitvalley USB HID Bootloader.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+#ifndef SIM_USB_H
+#define SIM_USB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "usb.h"
+
+/*** Host Build Model of the USB Module ******************************/
+//Runs the real device stack (usb_device.c, usb_device_hid.c,
+//usb_descriptors.c, usb_events.c) on the host.  sim_usb.c plays the SIE and
+//the host: it owns the buffer descriptor table the stack fills in, and for
+//every transaction the test asks for it checks the descriptor the SIE's
+//ping-pong pointer selects (UOWN, BSTALL, DTSEN/DTS, the byte count), moves
+//the data, writes the descriptor back, queues USTAT, sets TRNIF and runs
+//USBDeviceTasks() like the interrupt vector does.  Bus reset, SOF, suspend
+//and resume are the matching UIR flags.
+//
+//The host side tracks the device address and the DATA0/DATA1 toggle of
+//every endpoint, so a packet armed with the wrong DTS shows up as
+//SIM_USB_TOGGLE_ERROR.  Modelled limits: the USTAT FIFO is one entry deep
+//(a transaction is NAKed until the stack has taken the last one) and
+//interrupts are taken at once, between two calls of the test.
+//
+//Compile with -D__XC8 -D_PIC14E -Isim so usb.h picks usb_hal_pic16f1.h and
+//the mock xc.h (see xc.h in this directory).
+
+#define SIM_USB_ADDRESS     5       //device address given by SIM_UsbEnumerate()
+
+typedef enum
+{
+    SIM_USB_ACK,            //the transaction completed
+    SIM_USB_NAK,            //the CPU owns the descriptor, PKTDIS is set or USTAT is full
+    SIM_USB_STALL,          //the descriptor has BSTALL set
+    SIM_USB_TIMEOUT,        //no answer: another address, the direction is not
+                            //enabled, or the packet is larger than the buffer
+    SIM_USB_TOGGLE_ERROR    //ACKed, but dropped for the wrong DATA0/DATA1
+} SIM_USB_HANDSHAKE;
+
+/*********************************************************************
+* Function: void SIM_UsbBusReset(void);
+*
+* Overview: Resets the bus: the host goes back to address 0 and DATA0 on
+*           every endpoint, and the stack sees URSTIF.
+*
+* PreCondition: USBDeviceInit() and USBDeviceAttach() were called.
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+void SIM_UsbBusReset(void);
+
+/*********************************************************************
+* Function: void SIM_UsbStartOfFrame(void);
+*
+* Overview: Sends a start of frame, the 1ms tick of the stack.
+*
+* PreCondition: None
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+void SIM_UsbStartOfFrame(void);
+
+/*********************************************************************
+* Function: void SIM_UsbSuspend(void);
+*
+* Overview: Idles the bus long enough for IDLEIF, the stack suspends.
+*
+* PreCondition: None
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+void SIM_UsbSuspend(void);
+
+/*********************************************************************
+* Function: void SIM_UsbResume(void);
+*
+* Overview: Resumes bus activity, the stack sees ACTVIF and wakes up.
+*
+* PreCondition: None
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+void SIM_UsbResume(void);
+
+/*********************************************************************
+* Function: SIM_USB_HANDSHAKE SIM_UsbHostSetup(const uint8_t* setup);
+*
+* Overview: Sends the 8 byte SETUP packet of a control transfer to
+*           endpoint 0.
+*
+* PreCondition: None
+*
+* Input: const uint8_t* setup - the SETUP packet
+*
+* Output: SIM_USB_HANDSHAKE - how the device answered
+*
+********************************************************************/
+SIM_USB_HANDSHAKE SIM_UsbHostSetup(const uint8_t* setup);
+
+/*********************************************************************
+* Function: SIM_USB_HANDSHAKE SIM_UsbHostOut(uint8_t ep, const uint8_t* data, uint8_t length);
+*
+* Overview: Sends one OUT packet, with the host's data toggle of the
+*           endpoint.
+*
+* PreCondition: None
+*
+* Input: uint8_t ep - endpoint number
+*        const uint8_t* data - packet to send
+*        uint8_t length - packet length
+*
+* Output: SIM_USB_HANDSHAKE - how the device answered
+*
+********************************************************************/
+SIM_USB_HANDSHAKE SIM_UsbHostOut(uint8_t ep, const uint8_t* data, uint8_t length);
+
+/*********************************************************************
+* Function: SIM_USB_HANDSHAKE SIM_UsbHostIn(uint8_t ep, uint8_t* data, uint8_t* length);
+*
+* Overview: Reads one IN packet.
+*
+* PreCondition: None
+*
+* Input: uint8_t ep - endpoint number
+*        uint8_t* data - receives the packet, 64 bytes of room
+*        uint8_t* length - receives the packet length
+*
+* Output: SIM_USB_HANDSHAKE - how the device answered, the data is only
+*                             valid for SIM_USB_ACK
+*
+********************************************************************/
+SIM_USB_HANDSHAKE SIM_UsbHostIn(uint8_t ep, uint8_t* data, uint8_t* length);
+
+/*********************************************************************
+* Function: bool SIM_UsbControlRead(const uint8_t* setup, uint8_t* data, uint16_t* length);
+*
+* Overview: Runs a control read: the SETUP stage, IN data packets until a
+*           short one or wLength bytes, and the OUT status stage.
+*
+* PreCondition: None
+*
+* Input: const uint8_t* setup - the SETUP packet
+*        uint8_t* data - receives the data, wLength bytes of room
+*        uint16_t* length - receives the number of bytes read
+*
+* Output: bool - true if every stage was ACKed
+*
+********************************************************************/
+bool SIM_UsbControlRead(const uint8_t* setup, uint8_t* data, uint16_t* length);
+
+/*********************************************************************
+* Function: bool SIM_UsbControlWrite(const uint8_t* setup, const uint8_t* data);
+*
+* Overview: Runs a control write or a control transfer without data: the
+*           SETUP stage, wLength bytes in OUT packets and the IN status
+*           stage.  A SET_ADDRESS, SET_CONFIGURATION or CLEAR_FEATURE
+*           (ENDPOINT_HALT) takes effect on the host side once the status
+*           stage is through.
+*
+* PreCondition: None
+*
+* Input: const uint8_t* setup - the SETUP packet
+*        const uint8_t* data - wLength bytes to send
+*
+* Output: bool - true if every stage was ACKed
+*
+********************************************************************/
+bool SIM_UsbControlWrite(const uint8_t* setup, const uint8_t* data);
+
+/*********************************************************************
+* Function: bool SIM_UsbEnumerate(void);
+*
+* Overview: Resets the bus and enumerates the device like a host HID
+*           driver: device descriptor, SET_ADDRESS to SIM_USB_ADDRESS,
+*           configuration descriptor, SET_CONFIGURATION 1, then the HID
+*           report descriptor and SET_IDLE.
+*
+* PreCondition: USBDeviceInit() and USBDeviceAttach() were called.
+*
+* Input: None
+*
+* Output: bool - true if every request went through and the device is in
+*                the CONFIGURED_STATE
+*
+********************************************************************/
+bool SIM_UsbEnumerate(void);
+
+#endif //SIM_USB_H
@@ -0,0 +1,319 @@
+/*******************************************************************************
+
+    Author:  Gaurav Singh
+    website: www.circuitvalley.com
+    Created on October 28, 2017
+
+    This file is part of Circuitvalley USB HID Bootloader.
+
+    Circuitvalley USB HID Bootloader is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Circuitvalley USB HID Bootloader is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Circuitvalley USB HID Bootloader.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <xc.h>
+
+#define SIM_ADC_TRIGGER_MASK        0xF0    //ADCON2 TRIGSEL
+#define SIM_ADC_TRIGGER_TIMER2      0x50    //Timer2 match to PR2
+
+//Register file of the host build, see xc.h in this directory
+INTCONbits_t INTCONbits;
+PIE1bits_t PIE1bits;
+PIE2bits_t PIE2bits;
+PIR2bits_t PIR2bits;
+FVRCONbits_t FVRCONbits;
+volatile T2CONbits_t T2CONbits;
+PWM1CONbits_t PWM1CONbits;
+volatile UCONbits_t UCONbits;
+volatile UIRbits_t UIRbits;
+volatile UIEbits_t UIEbits;
+ANSELAbits_t ANSELAbits;
+ANSELBbits_t ANSELBbits;
+TRISAbits_t TRISAbits;
+TRISBbits_t TRISBbits;
+TRISCbits_t TRISCbits;
+
+volatile uint8_t simUEP[8];
+
+volatile uint8_t ADCON1;
+volatile uint8_t ADCON2;
+volatile uint8_t ADRESH;
+volatile uint8_t ADRESL;
+volatile uint8_t FVRCON;
+volatile uint8_t T1CON;
+volatile uint8_t T1GCON;
+volatile uint8_t TMR2;
+volatile uint8_t PR2;
+volatile uint8_t PWM1CON;
+volatile uint8_t PWM1DCH;
+volatile uint8_t PWM1DCL;
+volatile uint8_t UEIR;
+volatile uint8_t UEIE;
+volatile uint8_t USTAT;
+volatile uint8_t UADDR;
+volatile uint8_t UCFG;
+
+SIM_ADC_CONVERSION simAdcConversion;
+bool simTimer1HostClock;
+
+//The registers behind the polled names, see PIR1bits and ADCON0bits in xc.h
+static PIR1bits_t simPIR1bits;
+static ADCON0bits_t simADCON0bits;
+
+//Duty cycle latched at the last period boundary, and how many whole
+//periods it has been in effect for
+static uint16_t simPwmDuty;
+static uint32_t simPwmPeriods;
+
+//Instruction cycles left in the conversion under way, 0 for none
+static uint32_t simAdcCycles;
+
+//Timer1 on the simulated clock, and the byte last read from TMR1H/TMR1L
+static uint16_t simTimer1;
+static volatile uint8_t simTimer1Read;
+
+/** PRIVATE PROTOTYPES *********************************************/
+static void SIM_AdcStart(bool timer2Triggered);
+static void SIM_Timer2Match(void);
+static uint16_t SIM_Timer1(void);
+
+/*********************************************************************
+* Function: void SIM_AdcStart(bool timer2Triggered);
+*
+* Overview: Starts a conversion, unless one is already under way.
+*
+* PreCondition: None
+*
+* Input: bool timer2Triggered - started by the auto-conversion trigger
+*
+* Output: None
+*
+********************************************************************/
+static void SIM_AdcStart(bool timer2Triggered)
+{
+    if(simAdcCycles != 0)
+    {
+        return;
+    }
+
+    simADCON0bits.GO_nDONE = 1;
+    simAdcCycles = SIM_ADC_CONVERSION_CYCLES;
+
+    simAdcConversion.timer2Triggered = timer2Triggered;
+    simAdcConversion.pwm = simPwmDuty;
+    simAdcConversion.pwmPeriods = simPwmPeriods;
+}
+
+/*********************************************************************
+* Function: void SIM_Timer2Match(void);
+*
+* Overview: Ends a PWM period: latches the duty cycle registers, sets
+*           TMR2IF and fires the auto-conversion trigger.
+*
+* PreCondition: None
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+static void SIM_Timer2Match(void)
+{
+    uint16_t duty;
+
+    duty = ((uint16_t)PWM1DCH << 2) | (PWM1DCL >> 6);
+    if(duty != simPwmDuty)
+    {
+        simPwmDuty = duty;
+        simPwmPeriods = 0;
+    }
+    else
+    {
+        simPwmPeriods++;
+    }
+
+    simPIR1bits.TMR2IF = 1;
+
+    if((simADCON0bits.ADON == 1) && ((ADCON2 & SIM_ADC_TRIGGER_MASK) == SIM_ADC_TRIGGER_TIMER2))
+    {
+        SIM_AdcStart(true);
+    }
+}
+
+/*********************************************************************
+* Function: void SIM_Tick(uint32_t cycles);
+*
+* Overview: Advances the instruction clock, running Timer2 and the ADC.
+*
+* PreCondition: None
+*
+* Input: uint32_t cycles - instruction cycles (Fosc/4) to run
+*
+* Output: None
+*
+********************************************************************/
+void SIM_Tick(uint32_t cycles)
+{
+    //GO set by the firmware since the last tick
+    if((simADCON0bits.GO_nDONE == 1) && (simAdcCycles == 0))
+    {
+        SIM_AdcStart(false);
+    }
+
+    while(cycles != 0)
+    {
+        cycles--;
+
+        //TMR1ON, counting Fosc/4 at 1:1
+        if((T1CON & 0x01) != 0)
+        {
+            simTimer1++;
+        }
+
+        if(simAdcCycles != 0)
+        {
+            simAdcCycles--;
+            if(simAdcCycles == 0)
+            {
+                simADCON0bits.GO_nDONE = 0;
+                simPIR1bits.ADIF = 1;
+            }
+        }
+
+        //prescaler 1:1, the only setting the firmware uses
+        if(T2CONbits.TMR2ON == 1)
+        {
+            if(TMR2 == PR2)
+            {
+                TMR2 = 0;
+                SIM_Timer2Match();
+            }
+            else
+            {
+                TMR2++;
+            }
+        }
+    }
+}
+
+/*********************************************************************
+* Function: PIR1bits_t* SIM_PollPIR1(void);
+*
+* Overview: Advances the clock by SIM_CYCLES_PER_POLL and returns PIR1.
+*
+* PreCondition: None
+*
+* Input: None
+*
+* Output: PIR1bits_t* - the register
+*
+********************************************************************/
+PIR1bits_t* SIM_PollPIR1(void)
+{
+    SIM_Tick(SIM_CYCLES_PER_POLL);
+    return &simPIR1bits;
+}
+
+/*********************************************************************
+* Function: ADCON0bits_t* SIM_PollADCON0(void);
+*
+* Overview: Advances the clock by SIM_CYCLES_PER_POLL and returns ADCON0.
+*           A GO bit set since the last access starts a conversion.
+*
+* PreCondition: None
+*
+* Input: None
+*
+* Output: ADCON0bits_t* - the register
+*
+********************************************************************/
+ADCON0bits_t* SIM_PollADCON0(void)
+{
+    SIM_Tick(SIM_CYCLES_PER_POLL);
+    return &simADCON0bits;
+}
+
+/*********************************************************************
+* Function: static uint16_t SIM_Timer1(void);
+*
+* Overview: Returns the 16-bit Timer1 count, from the simulated clock or
+*           from the host's cycle counter when simTimer1HostClock is set.
+*
+* PreCondition: None
+*
+* Input: None
+*
+* Output: uint16_t - TMR1H:TMR1L
+*
+********************************************************************/
+static uint16_t SIM_Timer1(void)
+{
+    if(simTimer1HostClock == false)
+    {
+        return simTimer1;
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    return (uint16_t)__rdtsc();
+#else
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint16_t)now.tv_nsec;
+#endif
+}
+
+/*********************************************************************
+* Function: volatile uint8_t* SIM_Timer1High(void);
+*
+* Overview: Samples Timer1 and returns its high byte, TMR1H.
+*
+* PreCondition: None
+*
+* Input: None
+*
+* Output: volatile uint8_t* - the byte read
+*
+********************************************************************/
+volatile uint8_t* SIM_Timer1High(void)
+{
+    simTimer1Read = (uint8_t)(SIM_Timer1() >> 8);
+    return &simTimer1Read;
+}
+
+/*********************************************************************
+* Function: volatile uint8_t* SIM_Timer1Low(void);
+*
+* Overview: Samples Timer1 and returns its low byte, TMR1L.
+*
+* PreCondition: None
+*
+* Input: None
+*
+* Output: volatile uint8_t* - the byte read
+*
+********************************************************************/
+volatile uint8_t* SIM_Timer1Low(void)
+{
+    simTimer1Read = (uint8_t)SIM_Timer1();
+    return &simTimer1Read;
+}
@@ -0,0 +1,340 @@
+/*******************************************************************************
+
+    Author:  Gaurav Singh
+    website: www.circuitvalley.com
+    Created on October 28, 2017
+
+    This file is part of Circuitvalley USB HID Bootloader.
+
+    Circuitvalley USB HID Bootloader is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Circuitvalley USB HID Bootloader is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Circuitvalley USB HID Bootloader.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+
+#ifndef SIM_XC_H
+#define SIM_XC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*** Host Build Stand-in for <xc.h> ***********************************/
+//Lets firmware sources be compiled with gcc on the host, for the tests in
+//Host_source/.  Every special function register is a plain variable
+//(defined in sim_xc.c), so a test sets the inputs a module reads (ADRESH,
+//PIR1bits.RCIF, ...) and checks what it wrote.  Only the registers and bits
+//the tested modules use are declared.
+//
+//Timer2 and the ADC run on a simulated instruction clock (see SIM_Tick()):
+//Timer2 counts to PR2 while TMR2ON is set and sets TMR2IF at every match,
+//latching the PWM duty cycle like the device does, and a conversion started
+//by GO or by the Timer2 auto-conversion trigger (ADCON2) sets ADIF and
+//clears GO_nDONE SIM_ADC_CONVERSION_CYCLES later.  The result registers are
+//left alone: a conversion returns whatever the test put in ADRESH:ADRESL.
+//Timer1 counts the same clock while TMR1ON is set (Fosc/4, 1:1, the only
+//setting the firmware uses), or the host's own cycle counter once
+//simTimer1HostClock is set, for timing firmware code on the host.
+//The USB module is modelled in sim_usb.c.
+//
+//The USB headers pick their hardware layer from the compiler macros before
+//this file is reached, so a host build that includes usb.h also passes
+//-D__XC8 -D_PIC14E on the command line (see sim_usb.h).
+
+//Tells fixed_address_memory.h and usb_hal_pic16f1.h to leave out the XC8
+//@ placements
+#define SIM_HOST_BUILD
+
+//XC8 keywords and built-ins, the delays advance the instruction clock
+#define persistent
+#define interrupt
+#define _delay(cycles)      SIM_Tick(cycles)
+#define __delay_us(us)      SIM_Tick((uint32_t)(us) * SIM_CYCLES_PER_US)
+#define __delay_ms(ms)      SIM_Tick((uint32_t)(ms) * 1000 * SIM_CYCLES_PER_US)
+#define Nop()               SIM_Tick(1)
+#define ClrWdt()
+#define RESET()
+
+#define SIM_CYCLES_PER_US           12      //48MHz, Fosc/4
+#define SIM_CYCLES_PER_POLL         4       //a test of a flag and the branch back
+#define SIM_ADC_CONVERSION_CYCLES   184     //11.5 TAD at Fosc/64 (ADCON1 = 0xE3)
+
+typedef struct
+{
+    unsigned GIE:1;
+    unsigned PEIE:1;
+    unsigned TMR0IE:1;
+    unsigned TMR0IF:1;
+} INTCONbits_t;
+
+typedef struct
+{
+    unsigned TMR1IE:1;
+    unsigned TMR2IE:1;
+    unsigned TXIE:1;
+    unsigned RCIE:1;
+    unsigned ADIE:1;
+} PIE1bits_t;
+
+typedef struct
+{
+    unsigned TMR1IF:1;
+    unsigned TMR2IF:1;
+    unsigned TXIF:1;
+    unsigned RCIF:1;
+    unsigned ADIF:1;
+} PIR1bits_t;
+
+typedef struct
+{
+    unsigned USBIE:1;
+} PIE2bits_t;
+
+typedef struct
+{
+    unsigned USBIF:1;
+} PIR2bits_t;
+
+typedef struct
+{
+    unsigned TSRNG:1;
+    unsigned TSEN:1;
+} FVRCONbits_t;
+
+typedef struct
+{
+    unsigned PWM1OE:1;
+    unsigned PWM1EN:1;
+} PWM1CONbits_t;
+
+typedef struct { unsigned ANSA4:1; } ANSELAbits_t;
+typedef struct { unsigned ANSB4:1; } ANSELBbits_t;
+typedef struct { unsigned TRISA4:1; } TRISAbits_t;
+typedef struct { unsigned TRISB4:1; } TRISBbits_t;
+typedef struct { unsigned TRISC5:1; } TRISCbits_t;
+
+//Registers the firmware writes both as a byte and bit by bit are a single
+//byte: the register name is the bit field structure read as a byte, so the
+//bits are laid out as on the device.
+typedef union
+{
+    struct
+    {
+        uint8_t ADON:1;
+        uint8_t GO_nDONE:1;
+        uint8_t CHS:5;
+    };
+    struct
+    {
+        uint8_t :1;
+        uint8_t GO:1;
+    };
+} ADCON0bits_t;
+
+typedef struct
+{
+    uint8_t T2CKPS:2;
+    uint8_t TMR2ON:1;
+    uint8_t T2OUTPS:4;
+} T2CONbits_t;
+
+typedef struct
+{
+    uint8_t :1;
+    uint8_t SUSPND:1;
+    uint8_t RESUME:1;
+    uint8_t USBEN:1;
+    uint8_t PKTDIS:1;
+    uint8_t SE0:1;
+    uint8_t PPBRST:1;
+} UCONbits_t;
+
+typedef struct
+{
+    uint8_t URSTIF:1;
+    uint8_t UERRIF:1;
+    uint8_t ACTVIF:1;
+    uint8_t TRNIF:1;
+    uint8_t IDLEIF:1;
+    uint8_t STALLIF:1;
+    uint8_t SOFIF:1;
+} UIRbits_t;
+
+typedef struct
+{
+    uint8_t URSTIE:1;
+    uint8_t UERRIE:1;
+    uint8_t ACTVIE:1;
+    uint8_t TRNIE:1;
+    uint8_t IDLEIE:1;
+    uint8_t STALLIE:1;
+    uint8_t SOFIE:1;
+} UIEbits_t;
+
+typedef struct
+{
+    uint8_t EPSTALL:1;
+    uint8_t EPINEN:1;
+    uint8_t EPOUTEN:1;
+    uint8_t EPCONDIS:1;
+    uint8_t EPHSHK:1;
+} UEPbits_t;
+
+extern INTCONbits_t INTCONbits;
+extern PIE1bits_t PIE1bits;
+extern PIE2bits_t PIE2bits;
+extern PIR2bits_t PIR2bits;
+extern FVRCONbits_t FVRCONbits;
+extern volatile T2CONbits_t T2CONbits;
+extern PWM1CONbits_t PWM1CONbits;
+extern volatile UCONbits_t UCONbits;
+extern volatile UIRbits_t UIRbits;
+extern volatile UIEbits_t UIEbits;
+extern ANSELAbits_t ANSELAbits;
+extern ANSELBbits_t ANSELBbits;
+extern TRISAbits_t TRISAbits;
+extern TRISBbits_t TRISBbits;
+extern TRISCbits_t TRISCbits;
+
+#define T2CON   (*(volatile uint8_t*)&T2CONbits)
+#define UCON    (*(volatile uint8_t*)&UCONbits)
+#define UIR     (*(volatile uint8_t*)&UIRbits)
+#define UIE     (*(volatile uint8_t*)&UIEbits)
+
+//The flags the firmware polls advance the instruction clock on every
+//access, so a wait loop on TMR2IF, ADIF or GO_nDONE ends like on the device
+#define PIR1bits    (*SIM_PollPIR1())
+#define ADCON0bits  (*SIM_PollADCON0())
+#define ADCON0      (*(volatile uint8_t*)SIM_PollADCON0())
+
+//Reading either half of Timer1 samples the clock it counts
+#define TMR1H       (*SIM_Timer1High())
+#define TMR1L       (*SIM_Timer1Low())
+
+//The endpoint control registers are consecutive, DisableNonZeroEndpoints()
+//and USBEnableEndpoint() index them from UEP0/UEP1
+extern volatile uint8_t simUEP[8];
+#define UEP0        simUEP[0]
+#define UEP1        simUEP[1]
+#define UEP2        simUEP[2]
+#define UEP3        simUEP[3]
+#define UEP4        simUEP[4]
+#define UEP5        simUEP[5]
+#define UEP6        simUEP[6]
+#define UEP7        simUEP[7]
+#define UEP0bits    (*(volatile UEPbits_t*)&simUEP[0])
+
+extern volatile uint8_t ADCON1;
+extern volatile uint8_t ADCON2;
+extern volatile uint8_t ADRESH;
+extern volatile uint8_t ADRESL;
+extern volatile uint8_t FVRCON;
+extern volatile uint8_t T1CON;
+extern volatile uint8_t T1GCON;
+extern volatile uint8_t TMR2;
+extern volatile uint8_t PR2;
+extern volatile uint8_t PWM1CON;
+extern volatile uint8_t PWM1DCH;
+extern volatile uint8_t PWM1DCL;
+extern volatile uint8_t UEIR;
+extern volatile uint8_t UEIE;
+extern volatile uint8_t USTAT;
+extern volatile uint8_t UADDR;
+extern volatile uint8_t UCFG;
+
+//What the last conversion ran against, for the tests of the reads that are
+//synchronized to the PWM period
+typedef struct
+{
+    bool timer2Triggered;       //started by a Timer2 match, not by GO
+    uint16_t pwm;               //10-bit duty cycle in effect
+    uint32_t pwmPeriods;        //whole PWM periods it had been in effect for
+} SIM_ADC_CONVERSION;
+
+extern SIM_ADC_CONVERSION simAdcConversion;
+
+//Timer1 counts host CPU cycles (the time stamp counter on x86, nanoseconds
+//elsewhere) instead of the simulated instruction clock
+extern bool simTimer1HostClock;
+
+/*********************************************************************
+* Function: void SIM_Tick(uint32_t cycles);
+*
+* Overview: Advances the instruction clock, running Timer2 and the ADC.
+*
+* PreCondition: None
+*
+* Input: uint32_t cycles - instruction cycles (Fosc/4) to run
+*
+* Output: None
+*
+********************************************************************/
+void SIM_Tick(uint32_t cycles);
+
+/*********************************************************************
+* Function: PIR1bits_t* SIM_PollPIR1(void);
+*
+* Overview: Advances the clock by SIM_CYCLES_PER_POLL and returns PIR1.
+*
+* PreCondition: None
+*
+* Input: None
+*
+* Output: PIR1bits_t* - the register
+*
+********************************************************************/
+PIR1bits_t* SIM_PollPIR1(void);
+
+/*********************************************************************
+* Function: ADCON0bits_t* SIM_PollADCON0(void);
+*
+* Overview: Advances the clock by SIM_CYCLES_PER_POLL and returns ADCON0.
+*           A GO bit set since the last access starts a conversion.
+*
+* PreCondition: None
+*
+* Input: None
+*
+* Output: ADCON0bits_t* - the register
+*
+********************************************************************/
+ADCON0bits_t* SIM_PollADCON0(void);
+
+/*********************************************************************
+* Function: volatile uint8_t* SIM_Timer1High(void);
+*
+* Overview: Samples Timer1 and returns its high byte, TMR1H.
+*
+* PreCondition: None
+*
+* Input: None
+*
+* Output: volatile uint8_t* - the byte read
+*
+********************************************************************/
+volatile uint8_t* SIM_Timer1High(void);
+
+/*********************************************************************
+* Function: volatile uint8_t* SIM_Timer1Low(void);
+*
+* Overview: Samples Timer1 and returns its low byte, TMR1L.
+*
+* PreCondition: None
+*
+* Input: None
+*
+* Output: volatile uint8_t* - the byte read
+*
+********************************************************************/
+volatile uint8_t* SIM_Timer1Low(void);
+
+#endif //SIM_XC_H
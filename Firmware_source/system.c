@@ -26,6 +26,9 @@
 
 #include "adc.h"
 #include "pwm.h"
+#include "usb_profile.h"
+#include "scheduler.h"
+#include "usart.h"
 /** CONFIGURATION Bits **********************************************/
 // PIC16F1459 configuration bit settings:
 #define USE_INTERNAL_OSC
@@ -103,6 +106,12 @@ void SYSTEM_Initialize( SYSTEM_STATE state )
             PWM_Enable(PWM_CHANNEL_1);
 
             ADC_Enable(ADC_CHANNEL_INPUT);
+
+            SCHEDULER_Initialize();
+
+            #if defined(USB_ENABLE_CYCLE_PROFILING)
+                USB_ProfileInitialize();
+            #endif
             break;
             
         case SYSTEM_STATE_USB_SUSPEND: 
@@ -117,7 +126,29 @@ void SYSTEM_Initialize( SYSTEM_STATE state )
 			
 void interrupt SYS_InterruptHigh(void)
 {
+    if(PIE1bits.ADIE && PIR1bits.ADIF)
+    {
+        ADC_InterruptHandler();
+    }
+
+    if(INTCONbits.TMR0IE && INTCONbits.TMR0IF)
+    {
+        SCHEDULER_InterruptHandler();
+    }
+
+    if((PIE1bits.RCIE && PIR1bits.RCIF) || (PIE1bits.TXIE && PIR1bits.TXIF))
+    {
+        USART_InterruptHandler();
+    }
+
     #if defined(USB_INTERRUPT)
-        USBDeviceTasks();
+        //Only for USB interrupts, so the ADC, Timer0 and UART interrupts
+        //neither run the USB stack nor show up in its profile
+        if(PIE2bits.USBIE && PIR2bits.USBIF)
+        {
+            USB_PROFILE_BEGIN(USB_PROFILE_DEVICE_TASKS);
+            USBDeviceTasks();
+            USB_PROFILE_END(USB_PROFILE_DEVICE_TASKS);
+        }
     #endif
 }
@@ -31,6 +31,7 @@
 
 #include "io_mapping.h"
 #include "fixed_address_memory.h"
+#include "scheduler.h"
 
 
 
@@ -82,6 +83,6 @@ void SYSTEM_Initialize( SYSTEM_STATE state );
 *
 ********************************************************************/
 //void SYSTEM_Tasks(void);
-#define SYSTEM_Tasks()
+#define SYSTEM_Tasks() SCHEDULER_Tasks()
 
 #endif //SYSTEM_H
@@ -22,9 +22,35 @@
 
 #include <usart.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <xc.h>
 #include <usb_config.h>
+#if defined(USB_CDC_SET_LINE_CODING_HANDLER)
 #include <usb_device_cdc.h>
+#endif
+
+#define USART_RX_INDEX_MASK     (USART_RX_BUFFER_SIZE - 1)
+#define USART_TX_INDEX_MASK     (USART_TX_BUFFER_SIZE - 1)
+
+#define USART_BRG_MAX           0xFFFF
+
+//The interrupt only writes rxHead and txTail, the main loop only writes
+//rxTail and txHead, each index is a single byte so no locking is needed.
+static uint8_t rxBuffer[USART_RX_BUFFER_SIZE];
+static uint8_t txBuffer[USART_TX_BUFFER_SIZE];
+static volatile uint8_t rxHead;
+static volatile uint8_t rxTail;
+static volatile uint8_t txHead;
+static volatile uint8_t txTail;
+static volatile USART_STATISTICS rxErrors;
+#if defined(USB_CDC_SET_LINE_CODING_HANDLER)
+//Set by the SET_LINE_CODING handler (USB interrupt), cleared by
+//USART_LineCodingTasks() in the main loop once the new rate is applied
+static volatile bool lineCodingChanged;
+#endif
+
+/** PRIVATE PROTOTYPES *********************************************/
+static void USART_CountError(volatile uint16_t* counter);
 
 /******************************************************************************
  * Function:        void USART_Initialize(void)
@@ -35,32 +61,80 @@
  *
  * Output:          None
  *
- * Side Effects:    None
+ * Side Effects:    Empties both ring buffers and enables the EUSART interrupts
  *
  * Overview:        This routine initializes the UART to the value set by Host Terminal Application
  *
- * Note:
+ * Note:            The baud rate generator is left as it is, call
+ *                  USART_SetBaudRate() first.
  *
  *****************************************************************************/
 
 void USART_Initialize()
 {
        unsigned char c;
-     
+
+       PIE1bits.RCIE = 0;
+       PIE1bits.TXIE = 0;
+
+       rxHead = 0;
+       rxTail = 0;
+       txHead = 0;
+       txTail = 0;
+
        ANSELBbits.ANSB5 = 0;    // Make RB5 pin digital
      
         UART_TRISRx=1;				// RX
         UART_TRISTx=0;				// TX
         TXSTA = 0x24;       	// TX enable BRGH=1
         RCSTA = 0x90;       	// Single Character RX
-        //SPBRG = 0x71;
-        //SPBRGH = 0x02;      	// 0x0271 for 48MHz -> 19200 baud
         BAUDCON = 0x08;     	// BRG16 = 1
         c = RCREG;				// read
-    
+        c = RCREG;				// and the second FIFO entry
 
+        //TXIE is only set while the TX ring holds data
+        INTCONbits.PEIE = 1;
+        PIE1bits.RCIE = 1;
 }//end USART_Initialize
 
+/*********************************************************************
+* Function: void USART_SetBaudRate(uint32_t baudRate);
+*
+* Overview: Sets the baud rate generator.  With BRG16 and BRGH set the
+*           divisor is Fosc/4/baud, so anything from 184 baud up to 3Mbaud
+*           can be reached.
+*
+* PreCondition: None
+*
+* Input: uint32_t baudRate - baud rate in bits per second
+*
+* Output: None
+*
+********************************************************************/
+void USART_SetBaudRate(uint32_t baudRate)
+{
+    uint32_t divisor;
+
+    if(baudRate == 0)
+    {
+        return;
+    }
+
+    //rounded to the nearest divisor rather than truncated
+    divisor = (((GetSystemClock()/4) + (baudRate/2)) / baudRate);
+    if(divisor != 0)
+    {
+        divisor--;
+    }
+    if(divisor > USART_BRG_MAX)
+    {
+        divisor = USART_BRG_MAX;
+    }
+
+    SPBRG = (uint8_t) divisor;
+    SPBRGH = (uint8_t)((uint16_t) (divisor >> 8));
+}
+
 /******************************************************************************
  * Function:        void USART_putcUSART(char c)
  *
@@ -74,14 +148,73 @@ void USART_Initialize()
  *
  * Overview:        Print the input character to the UART
  *
- * Note:
+ * Note:            Waits for room in the TX ring, use USART_Write() to
+ *                  avoid blocking.
  *
  *****************************************************************************/
 void USART_putcUSART(char c)
 {
-      TXREG = c;
+    while(USART_Write((uint8_t)c) == false)
+    {
+    }
 }
 
+/*********************************************************************
+* Function: bool USART_Write(uint8_t data);
+*
+* Overview: Queues one byte for transmission without waiting.
+*
+* PreCondition: USART_Initialize() was called
+*
+* Input: uint8_t data - byte to send
+*
+* Output: bool - false if the TX ring was full and the byte was not queued
+*
+********************************************************************/
+bool USART_Write(uint8_t data)
+{
+    uint8_t next;
+
+    next = (txHead + 1) & USART_TX_INDEX_MASK;
+    if(next == txTail)
+    {
+        return false;
+    }
+
+    txBuffer[txHead] = data;
+    txHead = next;
+    PIE1bits.TXIE = 1;
+
+    return true;
+}
+
+/*********************************************************************
+* Function: uint8_t USART_WriteBuffer(const uint8_t* data, uint8_t length);
+*
+* Overview: Queues as many bytes as fit in the TX ring without waiting.
+*
+* PreCondition: USART_Initialize() was called
+*
+* Input: const uint8_t* data - bytes to send
+*        uint8_t length - number of bytes
+*
+* Output: uint8_t - number of bytes queued
+*
+********************************************************************/
+uint8_t USART_WriteBuffer(const uint8_t* data, uint8_t length)
+{
+    uint8_t count;
+
+    for(count = 0; count < length; count++)
+    {
+        if(USART_Write(data[count]) == false)
+        {
+            break;
+        }
+    }
+
+    return count;
+}
 
 /******************************************************************************
  * Function:        void USART_mySetLineCodingHandler(void)
@@ -99,7 +232,9 @@ void USART_putcUSART(char c)
  *                  and determine if the application should update the baudrate
  *                  or not.
  *
- * Note:
+ * Note:            Runs from the EP0 completion, in the USB interrupt.  The
+ *                  EUSART is only restarted by USART_LineCodingTasks() in
+ *                  the main loop, so the ring indexes keep a single writer.
  *
  *****************************************************************************/
 #if defined(USB_CDC_SET_LINE_CODING_HANDLER)
@@ -129,20 +264,49 @@ void USART_mySetLineCodingHandler(void)
         //Update the baudrate info in the CDC driver
         CDCSetBaudRate(cdc_notice.GetLineCoding.dwDTERate);
 
-        //Update the baudrate of the UART
-        
-            uint32_t dwBaud;
-            dwBaud = ((GetSystemClock()/4) / line_coding.dwDTERate) - 1;
-            SPBRG = (uint8_t) dwBaud;
-            SPBRGH = (uint8_t)((uint16_t) (dwBaud >> 8));
+        //Let the main loop update the baudrate of the UART
+        lineCodingChanged = true;
+}
+
+/*********************************************************************
+* Function: void USART_LineCodingTasks(void);
+*
+* Overview: Restarts the EUSART with the baud rate of the last
+*           SET_LINE_CODING request, if one arrived since the last call.
+*           Both ring buffers are emptied.
+*
+* PreCondition: Called from the main loop only, never while another
+*   main loop caller is inside a USART_ function.
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+void USART_LineCodingTasks(void)
+{
+    uint32_t baudRate;
+    uint8_t usbEnabled;
+
+    if(lineCodingChanged == false)
+    {
+        return;
+    }
+
+    //the handler may store a newer rate at any time, copy it in one piece
+    usbEnabled = PIE2bits.USBIE;
+    PIE2bits.USBIE = 0;
+    lineCodingChanged = false;
+    baudRate = line_coding.dwDTERate;
+    PIE2bits.USBIE = usbEnabled;
 
-        
+    USART_SetBaudRate(baudRate);
     USART_Initialize();
 }
 #endif
 
 /******************************************************************************
- * Function:        void USART_getcUSART(char c)
+ * Function:        unsigned char USART_getcUSART(void)
  *
  * PreCondition:    None
  *
@@ -152,28 +316,233 @@ void USART_mySetLineCodingHandler(void)
  *
  * Side Effects:    None
  *
- * Overview:        Print the input character to the UART
+ * Overview:        Get the input character from the UART
  *
- * Note:
+ * Note:            Returns 0 if nothing has been received, use
+ *                  USART_Read() to tell that apart from a received 0.
  *
  *****************************************************************************/
 unsigned char USART_getcUSART ()
 {
-	char  c;
-
-	if (RCSTAbits.OERR)  // in case of overrun error
-	{                    // we should never see an overrun error, but if we do,
-		RCSTAbits.CREN = 0;  // reset the port
-		c = RCREG;
-		RCSTAbits.CREN = 1;  // and keep going.
-	}
-	else
+    uint8_t c;
+
+    if(USART_Read(&c) == false)
     {
-		c = RCREG;
+        c = 0;
     }
-// not necessary.  EUSART auto clears the flag when RCREG is cleared
-//	PIR1bits.RCIF = 0;    // clear Flag
 
-  
-	return c;
-}
\ No newline at end of file
+    return c;
+}
+
+/*********************************************************************
+* Function: bool USART_Read(uint8_t* data);
+*
+* Overview: Takes one received byte without waiting.
+*
+* PreCondition: USART_Initialize() was called
+*
+* Input: uint8_t* data - where to store the byte
+*
+* Output: bool - false if nothing has been received
+*
+********************************************************************/
+bool USART_Read(uint8_t* data)
+{
+    uint8_t tail;
+
+    tail = rxTail;
+    if(tail == rxHead)
+    {
+        return false;
+    }
+
+    *data = rxBuffer[tail];
+    rxTail = (tail + 1) & USART_RX_INDEX_MASK;
+
+    return true;
+}
+
+/*********************************************************************
+* Function: uint8_t USART_ReadBuffer(uint8_t* data, uint8_t length);
+*
+* Overview: Takes up to length received bytes without waiting.
+*
+* PreCondition: USART_Initialize() was called
+*
+* Input: uint8_t* data - where to store the bytes
+*        uint8_t length - space available
+*
+* Output: uint8_t - number of bytes stored
+*
+********************************************************************/
+uint8_t USART_ReadBuffer(uint8_t* data, uint8_t length)
+{
+    uint8_t count;
+
+    for(count = 0; count < length; count++)
+    {
+        if(USART_Read(&data[count]) == false)
+        {
+            break;
+        }
+    }
+
+    return count;
+}
+
+/*********************************************************************
+* Function: uint8_t USART_RxCount(void);
+*
+* Overview: Returns the number of received bytes waiting to be read.
+*
+* PreCondition: USART_Initialize() was called
+*
+* Input: None
+*
+* Output: uint8_t - bytes in the RX ring
+*
+********************************************************************/
+uint8_t USART_RxCount(void)
+{
+    return (rxHead - rxTail) & USART_RX_INDEX_MASK;
+}
+
+/*********************************************************************
+* Function: uint8_t USART_TxFree(void);
+*
+* Overview: Returns how many bytes can be queued before the TX ring is full.
+*
+* PreCondition: USART_Initialize() was called
+*
+* Input: None
+*
+* Output: uint8_t - free space in the TX ring
+*
+********************************************************************/
+uint8_t USART_TxFree(void)
+{
+    return (USART_TX_BUFFER_SIZE - 1) - ((txHead - txTail) & USART_TX_INDEX_MASK);
+}
+
+/*********************************************************************
+* Function: void USART_GetStatistics(USART_STATISTICS* statistics, bool clear);
+*
+* Overview: Copies the receive error counters, optionally clearing them.
+*           Counters saturate at 0xFFFF.
+*
+* PreCondition: None
+*
+* Input: USART_STATISTICS* statistics - where to copy the counters
+*        bool clear - true to restart the counters from zero
+*
+* Output: None
+*
+********************************************************************/
+void USART_GetStatistics(USART_STATISTICS* statistics, bool clear)
+{
+    bool rxEnabled;
+    bool txEnabled;
+
+    //the counters are 16 bit, keep the interrupt out while they are copied.
+    //A TXIF interrupt runs the receive path too, so mask both sources.
+    rxEnabled = PIE1bits.RCIE;
+    txEnabled = PIE1bits.TXIE;
+    PIE1bits.RCIE = 0;
+    PIE1bits.TXIE = 0;
+
+    statistics->rxBufferOverruns = rxErrors.rxBufferOverruns;
+    statistics->rxHardwareOverruns = rxErrors.rxHardwareOverruns;
+    statistics->rxFramingErrors = rxErrors.rxFramingErrors;
+
+    if(clear == true)
+    {
+        rxErrors.rxBufferOverruns = 0;
+        rxErrors.rxHardwareOverruns = 0;
+        rxErrors.rxFramingErrors = 0;
+    }
+
+    PIE1bits.TXIE = txEnabled;
+    PIE1bits.RCIE = rxEnabled;
+}
+
+/*********************************************************************
+* Function: void USART_InterruptHandler(void);
+*
+* Overview: Moves bytes between the EUSART and the ring buffers.  Called
+*           from the interrupt vector on RCIF or TXIF.
+*
+* PreCondition: USART_Initialize() was called
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+void USART_InterruptHandler(void)
+{
+    uint8_t c;
+    uint8_t next;
+
+    if(RCSTAbits.OERR)
+    {
+        //the FIFO is still valid but reception stops until CREN is cycled
+        USART_CountError(&rxErrors.rxHardwareOverruns);
+        RCSTAbits.CREN = 0;
+        RCSTAbits.CREN = 1;
+    }
+
+    //drain both FIFO entries in one pass
+    while(PIR1bits.RCIF)
+    {
+        if(RCSTAbits.FERR)
+        {
+            c = RCREG;
+            USART_CountError(&rxErrors.rxFramingErrors);
+            continue;
+        }
+
+        c = RCREG;
+        next = (rxHead + 1) & USART_RX_INDEX_MASK;
+        if(next == rxTail)
+        {
+            USART_CountError(&rxErrors.rxBufferOverruns);
+            continue;
+        }
+
+        rxBuffer[rxHead] = c;
+        rxHead = next;
+    }
+
+    if(PIE1bits.TXIE && PIR1bits.TXIF)
+    {
+        if(txTail == txHead)
+        {
+            PIE1bits.TXIE = 0;
+        }
+        else
+        {
+            TXREG = txBuffer[txTail];
+            txTail = (txTail + 1) & USART_TX_INDEX_MASK;
+        }
+    }
+}
+
+/*********************************************************************
+* Function: static void USART_CountError(volatile uint16_t* counter);
+*
+* Overview: Increments an error counter, saturating at 0xFFFF.
+*
+* PreCondition: None
+*
+* Input: volatile uint16_t* counter - counter to increment
+*
+* Output: None
+*
+********************************************************************/
+static void USART_CountError(volatile uint16_t* counter)
+{
+    if(*counter != 0xFFFF)
+    {
+        (*counter)++;
+    }
+}
@@ -24,6 +24,7 @@
 #define USART_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #define CLOCK_FREQ 48000000
 #define GetSystemClock() CLOCK_FREQ
@@ -46,6 +47,20 @@
 #define mInitDTSPin() {}//{TRISAbits.TRISA3 = 1;}   //Configure DTS as a digital input.  (Make sure pin is digital if ANxx functions is present on the pin)
 #define mInitDTRPin() {TRISCbits.TRISC3 = 0;}   //Configure DTR as a digital output.
 
+//Receive and transmit are interrupt driven through RAM ring buffers, so USB
+//servicing can hold the CPU for a while without the 2 byte EUSART receive
+//FIFO overrunning.  Sizes must be powers of two no larger than 128, and
+//large enough to hold a whole HID bridge report (see COMMAND_UART_DATA).
+#define USART_RX_BUFFER_SIZE    64
+#define USART_TX_BUFFER_SIZE    64
+
+typedef struct
+{
+    uint16_t rxBufferOverruns;      //bytes dropped because the RX ring was full
+    uint16_t rxHardwareOverruns;    //OERR, the EUSART FIFO overflowed before the interrupt ran
+    uint16_t rxFramingErrors;       //bytes dropped for a missing stop bit
+} USART_STATISTICS;
+
 
 /*********************************************************************
 * Function: void USART_Initialize(void);
@@ -61,6 +76,139 @@
 ********************************************************************/
 void USART_Initialize();
 
+/*********************************************************************
+* Function: void USART_SetBaudRate(uint32_t baudRate);
+*
+* Overview: Sets the baud rate generator.  With BRG16 and BRGH set the
+*           divisor is Fosc/4/baud, so anything from 184 baud up to 3Mbaud
+*           can be reached.
+*
+* PreCondition: None
+*
+* Input: uint32_t baudRate - baud rate in bits per second
+*
+* Output: None
+*
+********************************************************************/
+void USART_SetBaudRate(uint32_t baudRate);
+
+/*********************************************************************
+* Function: bool USART_Write(uint8_t data);
+*
+* Overview: Queues one byte for transmission without waiting.
+*
+* PreCondition: USART_Initialize() was called
+*
+* Input: uint8_t data - byte to send
+*
+* Output: bool - false if the TX ring was full and the byte was not queued
+*
+********************************************************************/
+bool USART_Write(uint8_t data);
+
+/*********************************************************************
+* Function: uint8_t USART_WriteBuffer(const uint8_t* data, uint8_t length);
+*
+* Overview: Queues as many bytes as fit in the TX ring without waiting.
+*
+* PreCondition: USART_Initialize() was called
+*
+* Input: const uint8_t* data - bytes to send
+*        uint8_t length - number of bytes
+*
+* Output: uint8_t - number of bytes queued
+*
+********************************************************************/
+uint8_t USART_WriteBuffer(const uint8_t* data, uint8_t length);
+
+/*********************************************************************
+* Function: bool USART_Read(uint8_t* data);
+*
+* Overview: Takes one received byte without waiting.
+*
+* PreCondition: USART_Initialize() was called
+*
+* Input: uint8_t* data - where to store the byte
+*
+* Output: bool - false if nothing has been received
+*
+********************************************************************/
+bool USART_Read(uint8_t* data);
+
+/*********************************************************************
+* Function: uint8_t USART_ReadBuffer(uint8_t* data, uint8_t length);
+*
+* Overview: Takes up to length received bytes without waiting.
+*
+* PreCondition: USART_Initialize() was called
+*
+* Input: uint8_t* data - where to store the bytes
+*        uint8_t length - space available
+*
+* Output: uint8_t - number of bytes stored
+*
+********************************************************************/
+uint8_t USART_ReadBuffer(uint8_t* data, uint8_t length);
+
+/*********************************************************************
+* Function: uint8_t USART_RxCount(void);
+*
+* Overview: Returns the number of received bytes waiting to be read.
+*
+* PreCondition: USART_Initialize() was called
+*
+* Input: None
+*
+* Output: uint8_t - bytes in the RX ring
+*
+********************************************************************/
+uint8_t USART_RxCount(void);
+
+/*********************************************************************
+* Function: uint8_t USART_TxFree(void);
+*
+* Overview: Returns how many bytes can be queued before the TX ring is full.
+*
+* PreCondition: USART_Initialize() was called
+*
+* Input: None
+*
+* Output: uint8_t - free space in the TX ring
+*
+********************************************************************/
+uint8_t USART_TxFree(void);
+
+/*********************************************************************
+* Function: void USART_GetStatistics(USART_STATISTICS* statistics, bool clear);
+*
+* Overview: Copies the receive error counters, optionally clearing them.
+*           Counters saturate at 0xFFFF.
+*
+* PreCondition: None
+*
+* Input: USART_STATISTICS* statistics - where to copy the counters
+*        bool clear - true to restart the counters from zero
+*
+* Output: None
+*
+********************************************************************/
+void USART_GetStatistics(USART_STATISTICS* statistics, bool clear);
+
+/*********************************************************************
+* Function: void USART_InterruptHandler(void);
+*
+* Overview: Moves bytes between the EUSART and the ring buffers.  Called
+*           from the interrupt vector on RCIF or TXIF.
+*
+* PreCondition: USART_Initialize() was called
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+void USART_InterruptHandler(void);
+
 /******************************************************************************
  * Function:        void USART_putcUSART(char c)
  *
@@ -74,7 +222,8 @@ void USART_Initialize();
  *
  * Overview:        Print the input character to the UART
  *
- * Note:
+ * Note:            Waits for room in the TX ring, use USART_Write() to
+ *                  avoid blocking.
  *
  *****************************************************************************/
 void USART_putcUSART(char);
@@ -100,6 +249,23 @@ void USART_putcUSART(char);
  *****************************************************************************/
 void USART_mySetLineCodingHandler(void);
 
+/*********************************************************************
+* Function: void USART_LineCodingTasks(void);
+*
+* Overview: Applies a baud rate change requested with SET_LINE_CODING.
+*           USART_mySetLineCodingHandler() runs in the USB interrupt and
+*           only takes note of the request, the EUSART is restarted here.
+*
+* PreCondition: USB_CDC_SET_LINE_CODING_HANDLER is defined.  Call from
+*   the main loop.
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+void USART_LineCodingTasks(void);
+
 /******************************************************************************
  * Function:        unsigned char USART_getcUSART()
  *
@@ -113,7 +279,8 @@ void USART_mySetLineCodingHandler(void);
  *
  * Overview:        Get the input character from the UART
  *
- * Note:
+ * Note:            Returns 0 if nothing has been received, use
+ *                  USART_Read() to tell that apart from a received 0.
  *
  *****************************************************************************/
 unsigned char USART_getcUSART(void);
@@ -34,8 +34,31 @@ please contact mla_licensing@microchip.com
 								// that use EP0 IN or OUT for sending large amounts of
 								// application related data.
 									
-#define USB_MAX_NUM_INT     	1   //Set this number to match the maximum interface number used in the descriptors for this firmware project
-#define USB_MAX_EP_NUMBER	    1   //Set this number to match the maximum endpoint number used in the descriptors for this firmware project
+//Adds a CDC-ACM virtual serial port (interfaces 1 and 2, endpoints 2 and 3)
+//next to the custom HID interface, bridged to the EUSART.  The BDT grows by
+//32 bytes and the bulk buffers take the last free dual port RAM, see
+//fixed_address_memory.h.
+//#define USB_USE_CDC
+
+//Adds a second, IN only, HID interface (interface 1, endpoint 2) that carries
+//the sample stream, so EP1 is left to command replies.  Also needs the free
+//dual port RAM, so it can not be combined with USB_USE_CDC.
+//#define USB_USE_HID_STREAM
+
+#if defined(USB_USE_CDC) && defined(USB_USE_HID_STREAM)
+    #error "USB_USE_CDC and USB_USE_HID_STREAM share the free USB RAM, enable only one of them"
+#endif
+
+#if defined(USB_USE_CDC)
+    #define USB_MAX_NUM_INT     3   //Set this number to match the maximum interface number used in the descriptors for this firmware project
+    #define USB_MAX_EP_NUMBER   3   //Set this number to match the maximum endpoint number used in the descriptors for this firmware project
+#elif defined(USB_USE_HID_STREAM)
+    #define USB_MAX_NUM_INT     2   //Set this number to match the maximum interface number used in the descriptors for this firmware project
+    #define USB_MAX_EP_NUMBER   2   //Set this number to match the maximum endpoint number used in the descriptors for this firmware project
+#else
+    #define USB_MAX_NUM_INT     1   //Set this number to match the maximum interface number used in the descriptors for this firmware project
+    #define USB_MAX_EP_NUMBER   1   //Set this number to match the maximum endpoint number used in the descriptors for this firmware project
+#endif
 
 //Device descriptor - if these two definitions are not defined then
 //  a const USB_DEVICE_DESCRIPTOR variable by the exact name of device_dsc
@@ -137,6 +160,13 @@ please contact mla_licensing@microchip.com
 //Timeout(in milliseconds) = ((1000 * (USB_STATUS_STAGE_TIMEOUT - 1)) / (USBDeviceTasks() polling frequency in Hz))
 //------------------------------------------------------------------------------------------------------------------
 
+//Define USB_ENABLE_CYCLE_PROFILING to time the hot paths of the device stack
+//with Timer1 (see usb_profile.h).  The per-event cycle statistics are read
+//back with the COMMAND_GET_USB_PROFILE HID command.  Timer1 must be left free
+//running for this (ADC_StreamStart() only starts it with the same setting),
+//and every timed path gets a little slower, so keep it out of release builds.
+//#define USB_ENABLE_CYCLE_PROFILING
+
 #define USB_SUPPORT_DEVICE
 
 #define USB_NUM_STRING_DESCRIPTORS 3  //Set this number to match the total number of string descriptors that are implemented in the usb_descriptors.c file
@@ -169,6 +199,27 @@ please contact mla_licensing@microchip.com
 #define HID_NUM_OF_DSC          1
 #define HID_RPT01_SIZE          29
 
+#if defined(USB_USE_HID_STREAM)
+    #define HID_STREAM_INTF_ID      0x01
+    #define HID_STREAM_EP           2
+    #define HID_RPT02_SIZE          23
+#endif
+
+/* CDC */
+#if defined(USB_USE_CDC)
+    #define CDC_COMM_INTF_ID        0x01
+    #define CDC_COMM_EP             2
+    #define CDC_COMM_IN_EP_SIZE     8
+
+    #define CDC_DATA_INTF_ID        0x02
+    #define CDC_DATA_EP             3
+    #define CDC_DATA_OUT_EP_SIZE    32
+    #define CDC_DATA_IN_EP_SIZE     64
+
+    //SET_LINE_CODING reprograms the EUSART baud rate
+    #define USB_CDC_SET_LINE_CODING_HANDLER USART_mySetLineCodingHandler
+#endif
+
 /** DEFINITIONS ****************************************************/
 
 #endif //USBCFG_H
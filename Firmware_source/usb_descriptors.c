@@ -142,6 +142,9 @@ state according to the definition in the USB specification.
 /** INCLUDES *******************************************************/
 #include "usb.h"
 #include "usb_device_hid.h"
+#if defined(USB_USE_CDC)
+#include "usb_device_cdc.h"
+#endif
 
 /** CONSTANTS ******************************************************/
 #if defined(__18CXX)
@@ -154,13 +157,25 @@ const USB_DEVICE_DESCRIPTOR device_dsc=
     0x12,    // Size of this descriptor in bytes
     USB_DESCRIPTOR_DEVICE,                // DEVICE descriptor type
     0x0200,                 // USB Spec Release Number in BCD format
+#if defined(USB_USE_CDC)
+    MISC_DEVICE_CLASS,      // Class Code, interfaces are grouped by IADs
+    COMMON_CLASS_SUBCLASS,  // Subclass code
+    IAD_PROTOCOL,           // Protocol code
+#else
     0x00,                   // Class Code
     0x00,                   // Subclass code
     0x00,                   // Protocol code
+#endif
     USB_EP0_BUFF_SIZE,          // Max packet size for EP0, see usb_config.h
     0x04D8,                 // Vendor ID
     0x003F,                 // Product ID: Custom HID device demo
+#if defined(USB_USE_CDC)
+    0x0200,                 // Device release number in BCD format, hosts cache the interface list per release
+#elif defined(USB_USE_HID_STREAM)
+    0x0400,                 // Device release number in BCD format, hosts cache the interface list per release
+#else
     0x0100,                 // Device release number in BCD format
+#endif
     0x01,                   // Manufacturer string index
     0x02,                   // Product string index
     0x00,                   // Device serial number string index
@@ -172,8 +187,16 @@ const uint8_t configDescriptor1[]={
     /* Configuration Descriptor */
     0x09,//sizeof(USB_CFG_DSC),    // Size of this descriptor in bytes
     USB_DESCRIPTOR_CONFIGURATION,                // CONFIGURATION descriptor type
+#if defined(USB_USE_CDC)
+    0x6B,0x00,            // Total length of data for this cfg
+    3,                      // Number of interfaces in this cfg
+#elif defined(USB_USE_HID_STREAM)
+    0x42,0x00,            // Total length of data for this cfg
+    2,                      // Number of interfaces in this cfg
+#else
     0x29,0x00,            // Total length of data for this cfg
     1,                      // Number of interfaces in this cfg
+#endif
     1,                      // Index value of this configuration
     0,                      // Configuration string index
     _DEFAULT | _SELF,               // Attributes, see usb_device.h
@@ -213,7 +236,118 @@ const uint8_t configDescriptor1[]={
     CUSTOM_DEVICE_HID_EP | _EP_OUT,                   //EndpointAddress
     _INTERRUPT,                       //Attributes
     0x40,0x00,                  //size
-    0x01                        //Interval
+    0x01,                       //Interval
+
+#if defined(USB_USE_HID_STREAM)
+    /* Interface Descriptor */
+    0x09,//sizeof(USB_INTF_DSC),   // Size of this descriptor in bytes
+    USB_DESCRIPTOR_INTERFACE,               // INTERFACE descriptor type
+    HID_STREAM_INTF_ID,     // Interface Number
+    0,                      // Alternate Setting Number
+    1,                      // Number of endpoints in this intf
+    HID_INTF,               // Class code
+    0,     // Subclass code
+    0,     // Protocol code
+    0,                      // Interface string index
+
+    /* HID Class-Specific Descriptor */
+    0x09,//sizeof(USB_HID_DSC)+3,    // Size of this descriptor in bytes
+    DSC_HID,                // HID descriptor type
+    0x11,0x01,                 // HID Spec Release Number in BCD format (1.11)
+    0x00,                   // Country Code (0x00 for Not supported)
+    HID_NUM_OF_DSC,         // Number of class descriptors, see usbcfg.h
+    DSC_RPT,                // Report descriptor type
+    HID_RPT02_SIZE,0x00,//sizeof(hid_rpt02),      // Size of the report descriptor
+
+    /* Endpoint Descriptor */
+    0x07,/*sizeof(USB_EP_DSC)*/
+    USB_DESCRIPTOR_ENDPOINT,    //Endpoint Descriptor
+    HID_STREAM_EP | _EP_IN,                   //EndpointAddress
+    _INTERRUPT,                       //Attributes
+    0x40,0x00,                  //size
+    0x01,                       //Interval
+#endif
+
+#if defined(USB_USE_CDC)
+    /* Interface Association Descriptor: CDC Function */
+    0x08,                   // Size of this descriptor in bytes
+    DSC_IAD,                // INTERFACE ASSOCIATION descriptor type
+    CDC_COMM_INTF_ID,       // First interface of the function
+    2,                      // Number of interfaces in the function
+    COMM_INTF,              // Class code
+    ABSTRACT_CONTROL_MODEL, // Subclass code
+    V25TER,                 // Protocol code
+    0,                      // Function string index
+
+    /* Interface Descriptor */
+    0x09,//sizeof(USB_INTF_DSC),   // Size of this descriptor in bytes
+    USB_DESCRIPTOR_INTERFACE,               // INTERFACE descriptor type
+    CDC_COMM_INTF_ID,       // Interface Number
+    0,                      // Alternate Setting Number
+    1,                      // Number of endpoints in this intf
+    COMM_INTF,              // Class code
+    ABSTRACT_CONTROL_MODEL, // Subclass code
+    V25TER,                 // Protocol code
+    0,                      // Interface string index
+
+    /* CDC Class-Specific Descriptors */
+    0x05,                   // Header Functional Descriptor
+    CS_INTERFACE,
+    DSC_FN_HEADER,
+    0x10,0x01,              // CDC Spec Release Number in BCD format (1.10)
+
+    0x05,                   // Call Management Functional Descriptor
+    CS_INTERFACE,
+    DSC_FN_CALL_MGT,
+    0x00,                   // bmCapabilities: no call management
+    CDC_DATA_INTF_ID,       // bDataInterface
+
+    0x04,                   // Abstract Control Management Functional Descriptor
+    CS_INTERFACE,
+    DSC_FN_ACM,
+    0x02,                   // bmCapabilities: SET/GET_LINE_CODING, SET_CONTROL_LINE_STATE
+
+    0x05,                   // Union Functional Descriptor
+    CS_INTERFACE,
+    DSC_FN_UNION,
+    CDC_COMM_INTF_ID,       // bControlInterface
+    CDC_DATA_INTF_ID,       // bSubordinateInterface0
+
+    /* Endpoint Descriptor */
+    0x07,/*sizeof(USB_EP_DSC)*/
+    USB_DESCRIPTOR_ENDPOINT,    //Endpoint Descriptor
+    CDC_COMM_EP | _EP_IN,               //EndpointAddress
+    _INTERRUPT,                       //Attributes
+    CDC_COMM_IN_EP_SIZE,0x00,           //size
+    0x02,                       //Interval
+
+    /* Interface Descriptor */
+    0x09,//sizeof(USB_INTF_DSC),   // Size of this descriptor in bytes
+    USB_DESCRIPTOR_INTERFACE,               // INTERFACE descriptor type
+    CDC_DATA_INTF_ID,       // Interface Number
+    0,                      // Alternate Setting Number
+    2,                      // Number of endpoints in this intf
+    DATA_INTF,              // Class code
+    0,                      // Subclass code
+    NO_PROTOCOL,            // Protocol code
+    0,                      // Interface string index
+
+    /* Endpoint Descriptor */
+    0x07,/*sizeof(USB_EP_DSC)*/
+    USB_DESCRIPTOR_ENDPOINT,    //Endpoint Descriptor
+    CDC_DATA_EP | _EP_OUT,              //EndpointAddress
+    _BULK,                            //Attributes
+    CDC_DATA_OUT_EP_SIZE,0x00,          //size
+    0x00,                       //Interval
+
+    /* Endpoint Descriptor */
+    0x07,/*sizeof(USB_EP_DSC)*/
+    USB_DESCRIPTOR_ENDPOINT,    //Endpoint Descriptor
+    CDC_DATA_EP | _EP_IN,               //EndpointAddress
+    _BULK,                            //Attributes
+    CDC_DATA_IN_EP_SIZE,0x00,           //size
+    0x00                        //Interval
+#endif
 };
 
 //Language code string descriptor
@@ -254,6 +388,24 @@ const struct{uint8_t report[HID_RPT01_SIZE];}hid_rpt01={
     0xC0}                   // End Collection
 };                  
 
+#if defined(USB_USE_HID_STREAM)
+//Class specific descriptor - HID stream interface, input reports only
+const struct{uint8_t report[HID_RPT02_SIZE];}hid_rpt02={
+{
+    0x06, 0x00, 0xFF,       // Usage Page = 0xFF00 (Vendor Defined Page 1)
+    0x09, 0x02,             // Usage (Vendor Usage 2)
+    0xA1, 0x01,             // Collection (Application)
+    0x19, 0x01,             //      Usage Minimum 
+    0x29, 0x40,             //      Usage Maximum   //64 input usages total (0x01 to 0x40)
+    0x15, 0x00,             //      Logical Minimum (data bytes in the report may have minimum value = 0x00)
+    0x26, 0xFF, 0x00,       //      Logical Maximum (data bytes in the report may have maximum value = 0x00FF = unsigned 255)
+    0x75, 0x08,             //      Report Size: 8-bit field size
+    0x95, 0x40,             //      Report Count: Make sixty-four 8-bit fields
+    0x81, 0x00,             //      Input (Data, Array, Abs)
+    0xC0}                   // End Collection
+};
+#endif
+
 
 //Array of configuration descriptors
 const uint8_t *const USB_CD_Ptr[]=
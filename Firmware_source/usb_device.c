@@ -54,6 +54,7 @@ please contact mla_licensing@microchip.com
 #include "usb_ch9.h"
 #include "usb_device.h"
 #include "usb_device_local.h"
+#include "usb_profile.h"
 
 #ifndef uintptr_t
     #if  defined(__XC8__) || defined(__XC16__)
@@ -637,7 +638,9 @@ void USBDeviceTasks(void)
         #if defined(USB_SUPPORT_OTG)
             U1OTGIR = 0x10;        
         #else
+            USB_PROFILE_BEGIN(USB_PROFILE_WAKE);
             USBWakeFromSuspend();
+            USB_PROFILE_END(USB_PROFILE_WAKE);
         #endif
     }
 
@@ -691,7 +694,9 @@ void USBDeviceTasks(void)
             USBOTGSelectRole(ROLE_HOST);
             USBClearInterruptFlag(USBIdleIFReg,USBIdleIFBitNum);
         #else
+            USB_PROFILE_BEGIN(USB_PROFILE_SUSPEND);
             USBSuspend();
+            USB_PROFILE_END(USB_PROFILE_SUSPEND);
         #endif
     }
 
@@ -707,6 +712,8 @@ void USBDeviceTasks(void)
     //Start-of-Frame Interrupt
     if(USBSOFIF)
     {
+        USB_PROFILE_BEGIN(USB_PROFILE_SOF);
+
         //Call the user SOF event callback if enabled.
         if(USBSOFIE)
         {
@@ -746,6 +753,8 @@ void USBDeviceTasks(void)
                 USBCtrlEPAllowStatusStage();    //Does nothing if the status stage was already armed.
             } 
         #endif
+
+        USB_PROFILE_END(USB_PROFILE_SOF);
     }
 
     if(USBStallIF && USBStallIE)
@@ -813,7 +822,22 @@ void USBDeviceTasks(void)
                 }
                 else
                 {
+                    #if defined(USB_ENABLE_CYCLE_PROFILING)
+                    if(USBHALGetLastDirection(USTATcopy) == OUT_FROM_HOST)
+                    {
+                        USB_PROFILE_BEGIN(USB_PROFILE_TRANSFER_OUT);
+                        USB_TRANSFER_COMPLETE_HANDLER(EVENT_TRANSFER, (uint8_t*)&USTATcopy.Val, 0);
+                        USB_PROFILE_END(USB_PROFILE_TRANSFER_OUT);
+                    }
+                    else
+                    {
+                        USB_PROFILE_BEGIN(USB_PROFILE_TRANSFER_IN);
+                        USB_TRANSFER_COMPLETE_HANDLER(EVENT_TRANSFER, (uint8_t*)&USTATcopy.Val, 0);
+                        USB_PROFILE_END(USB_PROFILE_TRANSFER_IN);
+                    }
+                    #else
                     USB_TRANSFER_COMPLETE_HANDLER(EVENT_TRANSFER, (uint8_t*)&USTATcopy.Val, 0);
+                    #endif
                 }
             }//end if(USBTransactionCompleteIF)
             else
@@ -1015,6 +1039,8 @@ USB_HANDLE USBTransferOnePacket(uint8_t ep,uint8_t dir,uint8_t* data,uint8_t len
         return 0;
     }
 
+    USB_PROFILE_BEGIN(USB_PROFILE_TRANSFER_ONE_PACKET);
+
     //Toggle the DTS bit if required
     #if (USB_PING_PONG_MODE == USB_PING_PONG__NO_PING_PONG)
         handle->STAT.Val ^= _DTSMASK;
@@ -1043,6 +1069,8 @@ USB_HANDLE USBTransferOnePacket(uint8_t ep,uint8_t dir,uint8_t* data,uint8_t len
         //toggle over the to the next buffer for an OUT endpoint
         pBDTEntryOut[ep] = (BDT_ENTRY*)(((uintptr_t)pBDTEntryOut[ep]) ^ USB_NEXT_PING_PONG);
     }
+
+    USB_PROFILE_END(USB_PROFILE_TRANSFER_ONE_PACKET);
     return (USB_HANDLE)handle;
 }
 
@@ -1772,6 +1800,8 @@ static void USBCtrlTrfTxService(void)
 {
     uint8_t byteToSend;
 
+    USB_PROFILE_BEGIN(USB_PROFILE_CONTROL_TX_SERVICE);
+
     //Figure out how many bytes of data to send in the next IN transaction.
     //Assume a full size packet, unless otherwise determined below.
     byteToSend = USB_EP0_BUFF_SIZE;         
@@ -1822,6 +1852,8 @@ static void USBCtrlTrfTxService(void)
             byteToSend--;
         }//end while(byte_to_send.Val)
     }//end if(usb_stat.ctrl_trf_mem == _const)
+
+    USB_PROFILE_END(USB_PROFILE_CONTROL_TX_SERVICE);
 }//end USBCtrlTrfTxService
 
 /******************************************************************************
@@ -2405,19 +2437,25 @@ static void USBCtrlEPService(void)
             memcpy((uint8_t*)&SetupPkt, (uint8_t*)ConvertToVirtualAddress(pBDTEntryEP0OutCurrent->ADR), 8);
 
 			//Handle the control transfer (parse the 8-byte SETUP command and figure out what to do)
+            USB_PROFILE_BEGIN(USB_PROFILE_SETUP);
             USBCtrlTrfSetupHandler();
+            USB_PROFILE_END(USB_PROFILE_SETUP);
         }
         else
         {
 			//Handle the DATA transfer
+            USB_PROFILE_BEGIN(USB_PROFILE_CONTROL_OUT);
             USBCtrlTrfOutHandler();
+            USB_PROFILE_END(USB_PROFILE_CONTROL_OUT);
         }
     }
     else if((USTATcopy.Val & USTAT_EP0_PP_MASK) == USTAT_EP0_IN)
     {
 		//Otherwise the transmission was and EP0 IN
 		//  so take care of the IN transfer
+        USB_PROFILE_BEGIN(USB_PROFILE_CONTROL_IN);
         USBCtrlTrfInHandler();
+        USB_PROFILE_END(USB_PROFILE_CONTROL_IN);
     }
 
 }//end USBCtrlEPService
@@ -0,0 +1,280 @@
+/*******************************************************************************
+
+    Author:  Gaurav Singh
+    website: www.circuitvalley.com 
+    Created on October 28, 2017
+    
+    This file is part of Circuitvalley USB HID Bootloader.
+
+    Circuitvalley USB HID Bootloader is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Circuitvalley USB HID Bootloader is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Circuitvalley USB HID Bootloader.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+
+/** I N C L U D E S **********************************************************/
+#include <string.h>
+
+#include "system.h"
+#include "usb.h"
+#include "usb_device_cdc.h"
+
+#if defined(USB_USE_CDC)
+
+/** V A R I A B L E S ********************************************************/
+/* The CDC buffers have to be in the USB dual port RAM, see
+ * fixed_address_memory.h for the ones still free once the HID buffers and the
+ * larger BDT are in place.
+ */
+#if defined(FIXED_ADDRESS_MEMORY)
+    uint8_t cdc_data_rx[CDC_DATA_OUT_EP_SIZE] @ CDC_DATA_OUT_BUFFER_ADDRESS;
+    uint8_t cdc_data_tx[CDC_DATA_IN_EP_SIZE] @ CDC_DATA_IN_BUFFER_ADDRESS;
+#else
+    uint8_t cdc_data_rx[CDC_DATA_OUT_EP_SIZE];
+    uint8_t cdc_data_tx[CDC_DATA_IN_EP_SIZE];
+#endif
+
+LINE_CODING line_coding;
+volatile CDC_NOTICE cdc_notice;
+volatile CONTROL_SIGNAL_BITMAP control_signal_bitmap;
+uint8_t cdc_trf_state;
+
+static USB_HANDLE CDCDataOutHandle;
+static USB_HANDLE CDCDataInHandle;
+static bool cdcZeroLengthPending;
+
+#if defined(USB_CDC_SET_LINE_CODING_HANDLER)
+    void USB_CDC_SET_LINE_CODING_HANDLER(void);
+    #define LINE_CODING_TARGET  ((uint8_t*)&cdc_notice._byte[0])
+    #define LINE_CODING_PFUNC   USB_CDC_SET_LINE_CODING_HANDLER
+#else
+    #define LINE_CODING_TARGET  ((uint8_t*)&line_coding._byte[0])
+    #define LINE_CODING_PFUNC   NULL
+#endif
+
+/** C L A S S  S P E C I F I C  R E Q ****************************************/
+
+/******************************************************************************
+    Function:
+        void USBCheckCDCRequest(void)
+
+    Summary:
+        Handles the CDC-ACM class requests on EP0.  Call it from the
+        EVENT_EP0_REQUEST handler next to USBCheckHIDRequest().
+
+    PreCondition:
+        None
+
+    Parameters:
+        None
+
+    Return Values:
+        None
+ *****************************************************************************/
+void USBCheckCDCRequest(void)
+{
+    if(SetupPkt.Recipient != USB_SETUP_RECIPIENT_INTERFACE_BITFIELD) return;
+    if((SetupPkt.bIntfID != CDC_COMM_INTF_ID) && (SetupPkt.bIntfID != CDC_DATA_INTF_ID)) return;
+    if(SetupPkt.RequestType != USB_SETUP_TYPE_CLASS_BITFIELD) return;
+
+    switch(SetupPkt.bRequest)
+    {
+        //Encapsulated commands are only used by modems, unclaimed requests
+        //get STALLed by the stack.
+        case SEND_ENCAPSULATED_COMMAND:
+        case GET_ENCAPSULATED_RESPONSE:
+            break;
+
+        case SET_LINE_CODING:
+            USBEP0Receive(LINE_CODING_TARGET, SetupPkt.wLength, LINE_CODING_PFUNC);
+            break;
+
+        case GET_LINE_CODING:
+            USBEP0SendRAMPtr(
+                (uint8_t*)&line_coding,
+                LINE_CODING_LENGTH,
+                USB_EP0_INCLUDE_ZERO);
+            break;
+
+        case SET_CONTROL_LINE_STATE:
+            control_signal_bitmap._byte = (uint8_t)SetupPkt.W_Value.Val;
+            USBEP0Transmit(USB_EP0_NO_DATA);
+            break;
+
+        case SEND_BREAK:
+            USBEP0Transmit(USB_EP0_NO_DATA);
+            break;
+    }//end switch(SetupPkt.bRequest)
+}//end USBCheckCDCRequest
+
+/** U S E R  A P I ***********************************************************/
+
+/******************************************************************************
+    Function:
+        void CDCInitEP(void)
+
+    Summary:
+        Enables the CDC endpoints and arms the bulk OUT endpoint.  Call it
+        from the EVENT_CONFIGURED handler.
+
+    PreCondition:
+        None
+
+    Parameters:
+        None
+
+    Return Values:
+        None
+ *****************************************************************************/
+void CDCInitEP(void)
+{
+    //Keep the line coding a host set before a reconfiguration, only
+    //start from the defaults the first time.
+    if(line_coding.dwDTERate == 0)
+    {
+        line_coding.dwDTERate = 115200;
+        line_coding.bCharFormat = 0;
+        line_coding.bParityType = 0;
+        line_coding.bDataBits = 8;
+    }
+
+    control_signal_bitmap._byte = 0;
+    cdc_trf_state = CDC_TX_READY;
+    cdcZeroLengthPending = false;
+    CDCDataInHandle = 0;
+
+    //The notification endpoint is required by ACM but this device has no
+    //serial state to report, so nothing is ever sent on it.
+    USBEnableEndpoint(CDC_COMM_EP, USB_IN_ENABLED|USB_HANDSHAKE_ENABLED|USB_DISALLOW_SETUP);
+    USBEnableEndpoint(CDC_DATA_EP, USB_IN_ENABLED|USB_OUT_ENABLED|USB_HANDSHAKE_ENABLED|USB_DISALLOW_SETUP);
+
+    CDCDataOutHandle = USBRxOnePacket(CDC_DATA_EP, (uint8_t*)&cdc_data_rx[0], sizeof(cdc_data_rx));
+}//end CDCInitEP
+
+/******************************************************************************
+    Function:
+        uint8_t getsUSBUSART(uint8_t *buffer, uint8_t len)
+
+    Summary:
+        Copies the last bulk OUT packet, if one has arrived, and re-arms the
+        endpoint.
+
+    Description:
+        Bytes of the packet beyond len are dropped, so len should be at least
+        CDC_DATA_OUT_EP_SIZE.
+
+    PreCondition:
+        CDCInitEP() was called and the device is configured.
+
+    Parameters:
+        uint8_t *buffer - where to copy the data
+        uint8_t len - space in buffer
+
+    Return Values:
+        uint8_t - number of bytes copied, 0 if nothing arrived
+ *****************************************************************************/
+uint8_t getsUSBUSART(uint8_t *buffer, uint8_t len)
+{
+    uint8_t received;
+
+    if(USBHandleBusy(CDCDataOutHandle))
+    {
+        return 0;
+    }
+
+    received = (uint8_t)USBHandleGetLength(CDCDataOutHandle);
+    if(len > received)
+    {
+        len = received;
+    }
+    memcpy(buffer, (const void*)&cdc_data_rx[0], len);
+
+    CDCDataOutHandle = USBRxOnePacket(CDC_DATA_EP, (uint8_t*)&cdc_data_rx[0], sizeof(cdc_data_rx));
+
+    return len;
+}//end getsUSBUSART
+
+/******************************************************************************
+    Function:
+        void putUSBUSART(uint8_t *data, uint8_t length)
+
+    Summary:
+        Sends up to CDC_DATA_IN_EP_SIZE bytes on the bulk IN endpoint.
+
+    PreCondition:
+        USBUSARTIsTxTrfReady() returned true.
+
+    Parameters:
+        uint8_t *data - the bytes to send
+        uint8_t length - number of bytes, longer data is truncated
+
+    Return Values:
+        None
+ *****************************************************************************/
+void putUSBUSART(uint8_t *data, uint8_t length)
+{
+    if(length > sizeof(cdc_data_tx))
+    {
+        length = sizeof(cdc_data_tx);
+    }
+    memcpy((void*)&cdc_data_tx[0], data, length);
+
+    //a new packet also continues the transfer a pending ZLP would have ended
+    cdcZeroLengthPending = (length == sizeof(cdc_data_tx));
+    cdc_trf_state = CDC_TX_BUSY;
+    CDCDataInHandle = USBTxOnePacket(CDC_DATA_EP, (uint8_t*)&cdc_data_tx[0], length);
+}//end putUSBUSART
+
+/******************************************************************************
+    Function:
+        void CDCTxService(void)
+
+    Summary:
+        Completes bulk IN transfers, ending one with a zero length packet
+        when it finished on a full packet and nothing followed it.  Call it
+        once per main loop pass, after the application had its chance to
+        call putUSBUSART().
+
+    PreCondition:
+        CDCInitEP() was called.
+
+    Parameters:
+        None
+
+    Return Values:
+        None
+ *****************************************************************************/
+void CDCTxService(void)
+{
+    if(USBHandleBusy(CDCDataInHandle))
+    {
+        return;
+    }
+
+    switch(cdc_trf_state)
+    {
+        case CDC_TX_BUSY:
+            //give the application one pass to continue the transfer
+            cdc_trf_state = (cdcZeroLengthPending == true) ? CDC_TX_BUSY_ZLP : CDC_TX_READY;
+            break;
+
+        case CDC_TX_BUSY_ZLP:
+            cdcZeroLengthPending = false;
+            cdc_trf_state = CDC_TX_BUSY;
+            CDCDataInHandle = USBTxOnePacket(CDC_DATA_EP, NULL, 0);
+            break;
+    }
+}//end CDCTxService
+
+#endif //USB_USE_CDC
+/** EOF usb_device_cdc.c *****************************************************/
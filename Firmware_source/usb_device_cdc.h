@@ -0,0 +1,260 @@
+/*******************************************************************************
+
+    Author:  Gaurav Singh
+    website: www.circuitvalley.com 
+    Created on October 28, 2017
+    
+    This file is part of Circuitvalley USB HID Bootloader.
+
+    Circuitvalley USB HID Bootloader is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Circuitvalley USB HID Bootloader is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Circuitvalley USB HID Bootloader.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+
+#ifndef USB_DEVICE_CDC_H
+#define USB_DEVICE_CDC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "usb.h"
+#include "usb_config.h"
+
+/** DEFINITIONS ****************************************************/
+
+/* Class-Specific Requests */
+#define SEND_ENCAPSULATED_COMMAND   0x00
+#define GET_ENCAPSULATED_RESPONSE   0x01
+#define SET_LINE_CODING             0x20
+#define GET_LINE_CODING             0x21
+#define SET_CONTROL_LINE_STATE      0x22
+#define SEND_BREAK                  0x23
+
+/* Communication Interface Class Code */
+#define COMM_INTF                   0x02
+
+/* Communication Interface Class SubClass Codes */
+#define ABSTRACT_CONTROL_MODEL      0x02
+
+/* Communication Interface Class Control Protocol Codes */
+#define V25TER                      0x01    // Common AT commands ("Hayes(TM)")
+
+/* Data Interface Class Codes */
+#define DATA_INTF                   0x0A
+
+/* Data Interface Class Protocol Codes */
+#define NO_PROTOCOL                 0x00
+
+/* Communication Feature Selector Codes */
+#define CS_INTERFACE                0x24
+
+/* Functional Descriptor Subtypes */
+#define DSC_FN_HEADER               0x00
+#define DSC_FN_CALL_MGT             0x01
+#define DSC_FN_ACM                  0x02
+#define DSC_FN_UNION                0x06
+
+/* Interface Association Descriptor */
+#define DSC_IAD                     0x0B
+#define MISC_DEVICE_CLASS           0xEF
+#define COMMON_CLASS_SUBCLASS       0x02
+#define IAD_PROTOCOL                0x01
+
+/* CDC Bulk IN transfer states */
+#define CDC_TX_READY                0
+#define CDC_TX_BUSY                 1
+#define CDC_TX_BUSY_ZLP             2       // a full packet was sent, end the transfer with a ZLP
+
+#define LINE_CODING_LENGTH          0x07
+
+/** S T R U C T U R E S ******************************************************/
+
+/* Line Coding Structure */
+typedef union
+{
+    struct
+    {
+        uint8_t _byte[LINE_CODING_LENGTH];
+    };
+    struct
+    {
+        uint32_t dwDTERate;
+        uint8_t bCharFormat;    // 0 = 1 stop bit, 1 = 1.5, 2 = 2
+        uint8_t bParityType;    // 0 = None, 1 = Odd, 2 = Even, 3 = Mark, 4 = Space
+        uint8_t bDataBits;      // 5, 6, 7, 8 or 16
+    };
+} LINE_CODING;
+
+typedef union
+{
+    uint8_t _byte;
+    struct
+    {
+        unsigned DTE_PRESENT:1;     // DTR
+        unsigned CARRIER_CONTROL:1; // RTS
+    };
+} CONTROL_SIGNAL_BITMAP;
+
+/* SET_LINE_CODING data stage buffer, handed to USB_CDC_SET_LINE_CODING_HANDLER */
+typedef union
+{
+    LINE_CODING GetLineCoding;
+    LINE_CODING SetLineCoding;
+    uint8_t _byte[LINE_CODING_LENGTH];
+} CDC_NOTICE;
+
+/** E X T E R N S ************************************************************/
+extern LINE_CODING line_coding;
+extern volatile CDC_NOTICE cdc_notice;
+extern volatile CONTROL_SIGNAL_BITMAP control_signal_bitmap;
+extern uint8_t cdc_trf_state;
+
+/** M A C R O S **************************************************************/
+
+/******************************************************************************
+    Function:
+        void CDCSetBaudRate(uint32_t baudRate)
+
+    Summary:
+        Updates the baud rate reported back by GET_LINE_CODING.
+
+    Parameters:
+        uint32_t baudRate - the new baud rate
+ *****************************************************************************/
+#define CDCSetBaudRate(baudRate) {line_coding.dwDTERate=baudRate;}
+
+/******************************************************************************
+    Function:
+        bool USBUSARTIsTxTrfReady(void)
+
+    Summary:
+        Returns true when putUSBUSART() can be called.
+ *****************************************************************************/
+#define USBUSARTIsTxTrfReady()      (cdc_trf_state != CDC_TX_BUSY)
+
+/******************************************************************************
+    Function:
+        bool CDCIsDTEPresent(void)
+
+    Summary:
+        Returns true while the host holds DTR, i.e. a terminal has the port
+        open.
+ *****************************************************************************/
+#define CDCIsDTEPresent()           (control_signal_bitmap.DTE_PRESENT == 1)
+
+/** F U N C T I O N S ********************************************************/
+
+/******************************************************************************
+    Function:
+        void USBCheckCDCRequest(void)
+
+    Summary:
+        Handles the CDC-ACM class requests on EP0.  Call it from the
+        EVENT_EP0_REQUEST handler next to USBCheckHIDRequest().
+
+    PreCondition:
+        None
+
+    Parameters:
+        None
+
+    Return Values:
+        None
+ *****************************************************************************/
+void USBCheckCDCRequest(void);
+
+/******************************************************************************
+    Function:
+        void CDCInitEP(void)
+
+    Summary:
+        Enables the CDC endpoints and arms the bulk OUT endpoint.  Call it
+        from the EVENT_CONFIGURED handler.
+
+    PreCondition:
+        None
+
+    Parameters:
+        None
+
+    Return Values:
+        None
+ *****************************************************************************/
+void CDCInitEP(void);
+
+/******************************************************************************
+    Function:
+        uint8_t getsUSBUSART(uint8_t *buffer, uint8_t len)
+
+    Summary:
+        Copies the last bulk OUT packet, if one has arrived, and re-arms the
+        endpoint.
+
+    Description:
+        Bytes of the packet beyond len are dropped, so len should be at least
+        CDC_DATA_OUT_EP_SIZE.
+
+    PreCondition:
+        CDCInitEP() was called and the device is configured.
+
+    Parameters:
+        uint8_t *buffer - where to copy the data
+        uint8_t len - space in buffer
+
+    Return Values:
+        uint8_t - number of bytes copied, 0 if nothing arrived
+ *****************************************************************************/
+uint8_t getsUSBUSART(uint8_t *buffer, uint8_t len);
+
+/******************************************************************************
+    Function:
+        void putUSBUSART(uint8_t *data, uint8_t length)
+
+    Summary:
+        Sends up to CDC_DATA_IN_EP_SIZE bytes on the bulk IN endpoint.
+
+    PreCondition:
+        USBUSARTIsTxTrfReady() returned true.
+
+    Parameters:
+        uint8_t *data - the bytes to send
+        uint8_t length - number of bytes, longer data is truncated
+
+    Return Values:
+        None
+ *****************************************************************************/
+void putUSBUSART(uint8_t *data, uint8_t length);
+
+/******************************************************************************
+    Function:
+        void CDCTxService(void)
+
+    Summary:
+        Completes bulk IN transfers, ending one with a zero length packet
+        when it finished on a full packet and nothing followed it.  Call it
+        once per main loop pass, after the application had its chance to
+        call putUSBUSART().
+
+    PreCondition:
+        CDCInitEP() was called.
+
+    Parameters:
+        None
+
+    Return Values:
+        None
+ *****************************************************************************/
+void CDCTxService(void);
+
+#endif //USB_DEVICE_CDC_H
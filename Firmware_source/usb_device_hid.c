@@ -80,6 +80,13 @@ static uint8_t idle_rate;
 static uint8_t active_protocol;   // [0] Boot Protocol [1] Report Protocol
 
 extern const struct{uint8_t report[HID_RPT01_SIZE];}hid_rpt01;
+#if defined(USB_USE_HID_STREAM)
+extern const struct{uint8_t report[HID_RPT02_SIZE];}hid_rpt02;
+
+//Offset of the stream interface's HID descriptor in configDescriptor1: the
+//41 bytes of the command interface plus the stream interface descriptor.
+#define HID_STREAM_DSC_OFFSET   50
+#endif
 
 // *****************************************************************************
 // *****************************************************************************
@@ -153,7 +160,11 @@ extern const struct{uint8_t report[HID_RPT01_SIZE];}hid_rpt01;
 void USBCheckHIDRequest(void)
 {
     if(SetupPkt.Recipient != USB_SETUP_RECIPIENT_INTERFACE_BITFIELD) return;
+    #if defined(USB_USE_HID_STREAM)
+    if((SetupPkt.bIntfID != HID_INTF_ID) && (SetupPkt.bIntfID != HID_STREAM_INTF_ID)) return;
+    #else
     if(SetupPkt.bIntfID != HID_INTF_ID) return;
+    #endif
     
     /*
      * There are two standard requests that hid.c may support.
@@ -165,6 +176,16 @@ void USBCheckHIDRequest(void)
         switch(SetupPkt.bDescriptorType)
         {
             case DSC_HID: //HID Descriptor          
+                #if defined(USB_USE_HID_STREAM)
+                if((USBActiveConfiguration == 1) && (SetupPkt.bIntfID == HID_STREAM_INTF_ID))
+                {
+                    USBEP0SendROMPtr(
+                        (const uint8_t*)&configDescriptor1 + HID_STREAM_DSC_OFFSET,
+                        sizeof(USB_HID_DSC)+3,
+                        USB_EP0_INCLUDE_ZERO);
+                    break;
+                }
+                #endif
                 if(USBActiveConfiguration == 1)
                 {
                     USBEP0SendROMPtr(
@@ -174,6 +195,16 @@ void USBCheckHIDRequest(void)
                 }
                 break;
             case DSC_RPT:  //Report Descriptor           
+                #if defined(USB_USE_HID_STREAM)
+                if(SetupPkt.bIntfID == HID_STREAM_INTF_ID)
+                {
+                    USBEP0SendROMPtr(
+                        (const uint8_t*)&hid_rpt02,
+                        HID_RPT02_SIZE,
+                        USB_EP0_INCLUDE_ZERO);
+                    break;
+                }
+                #endif
                 //if(USBActiveConfiguration == 1)
                 {
                     USBEP0SendROMPtr(
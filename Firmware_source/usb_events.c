@@ -25,6 +25,9 @@ please contact mla_licensing@microchip.com
 
 #include "app_device_custom_hid.h"
 #include "app_led_usb_status.h"
+#if defined(USB_USE_CDC)
+#include "usb_device_cdc.h"
+#endif
 
 
 /*******************************************************************
@@ -56,9 +59,7 @@ bool USER_USB_CALLBACK_EVENT_HANDLER(USB_EVENT event, void *pdata, uint16_t size
             break;
 
         case EVENT_SOF:
-            /* We are using the SOF as a timer to time the LED indicator.  Call
-             * the LED update function here. */
-            APP_LEDUpdateUSBStatus();
+            /* The LED indicator is timed by the scheduler tick, see main(). */
             break;
 
         case EVENT_SUSPEND:
@@ -89,6 +90,9 @@ bool USER_USB_CALLBACK_EVENT_HANDLER(USB_EVENT event, void *pdata, uint16_t size
             /* When the device is configured, we can (re)initialize the demo
              * code. */
             APP_DeviceCustomHIDInitialize();
+            #if defined(USB_USE_CDC)
+                CDCInitEP();
+            #endif
             break;
 
         case EVENT_SET_DESCRIPTOR:
@@ -98,6 +102,9 @@ bool USER_USB_CALLBACK_EVENT_HANDLER(USB_EVENT event, void *pdata, uint16_t size
             /* We have received a non-standard USB request.  The HID driver
              * needs to check to see if the request was for it. */
             USBCheckHIDRequest();
+            #if defined(USB_USE_CDC)
+                USBCheckCDCRequest();
+            #endif
             break;
 
         case EVENT_BUS_ERROR:
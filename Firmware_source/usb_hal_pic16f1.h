@@ -183,7 +183,13 @@ please contact mla_licensing@microchip.com
 
 //----- Definitions for BDT address --------------------------------------------
 #define BDT_BASE_ADDR   0x2000
-#define BDT_BASE_ADDR_TAG @ BDT_BASE_ADDR
+#if defined(SIM_HOST_BUILD)
+    //Host build (sim/xc.h): no fixed USB RAM, but the even and odd entries
+    //must share an 8 byte block for USB_NEXT_PING_PONG to toggle between them
+    #define BDT_BASE_ADDR_TAG __attribute__((aligned(256)))
+#else
+    #define BDT_BASE_ADDR_TAG @ BDT_BASE_ADDR
+#endif
 #define BDT_ENTRY_SIZE 4
 
 #if (USB_PING_PONG_MODE == USB_PING_PONG__NO_PING_PONG)
@@ -200,8 +206,13 @@ please contact mla_licensing@microchip.com
 #define CTRL_TRF_SETUP_ADDR     BDT_BASE_ADDR + (BDT_ENTRY_SIZE * BDT_NUM_ENTRIES)
 #define CTRL_TRF_DATA_ADDR      CTRL_TRF_SETUP_ADDR + USB_EP0_BUFF_SIZE
 
-#define CTRL_TRF_SETUP_ADDR_TAG @ CTRL_TRF_SETUP_ADDR
-#define CTRL_TRF_DATA_ADDR_TAG  @ CTRL_TRF_DATA_ADDR
+#if defined(SIM_HOST_BUILD)
+    #define CTRL_TRF_SETUP_ADDR_TAG
+    #define CTRL_TRF_DATA_ADDR_TAG
+#else
+    #define CTRL_TRF_SETUP_ADDR_TAG @ CTRL_TRF_SETUP_ADDR
+    #define CTRL_TRF_DATA_ADDR_TAG  @ CTRL_TRF_DATA_ADDR
+#endif
 
 //----- Deprecated definitions - will be removed at some point of time----------
 //--------- Deprecated in v2.2
@@ -218,6 +229,12 @@ please contact mla_licensing@microchip.com
 // *****************************************************************************
 // *****************************************************************************
         
+#if defined(SIM_HOST_BUILD)
+    //a host compiler gives the unsigned bitfields below int storage, pack
+    //them so a descriptor keeps its 4 byte layout (USB_NEXT_PING_PONG)
+    #pragma pack(push, 1)
+#endif
+
 // Buffer Descriptor Status Register layout.
 typedef union _BD_STAT
 {
@@ -270,6 +287,10 @@ typedef union __BDT
     uint8_t v[4];
 } BDT_ENTRY;
 
+#if defined(SIM_HOST_BUILD)
+    #pragma pack(pop)
+#endif
+
 // USTAT Register Layout
 typedef union __USTAT
 {
@@ -318,8 +339,23 @@ typedef union _POINTER
 /****** Function prototypes and macro functions ******************************/
 /*****************************************************************************/
 
-#define ConvertToPhysicalAddress(a) (((uint16_t)(a)) & 0x7FFF)
-#define ConvertToVirtualAddress(a)  ((void *)(a))
+#if defined(SIM_HOST_BUILD)
+    //A host pointer does not fit the 16-bit buffer address of a descriptor,
+    //the SIE model in sim/sim_usb.c hands out one per buffer and maps it
+    //back.  It also resets its ping-pong pointers on every write of PPBRST,
+    //a pulse it could not see on a plain variable.
+    uint16_t SIM_UsbPhysicalAddress(const volatile void* address);
+    void* SIM_UsbVirtualAddress(uint16_t address);
+    volatile uint8_t* SIM_UsbPingPongBufferReset(void);
+
+    #define ConvertToPhysicalAddress(a) SIM_UsbPhysicalAddress(a)
+    #define ConvertToVirtualAddress(a)  SIM_UsbVirtualAddress(a)
+    #undef USBPingPongBufferReset
+    #define USBPingPongBufferReset      (*SIM_UsbPingPongBufferReset())
+#else
+    #define ConvertToPhysicalAddress(a) (((uint16_t)(a)) & 0x7FFF)
+    #define ConvertToVirtualAddress(a)  ((void *)(a))
+#endif
 #define USBClearUSBInterrupt() PIR2bits.USBIF = 0;
 #if defined(USB_INTERRUPT)
     #define USBMaskInterrupts() {PIE2bits.USBIE = 0;}
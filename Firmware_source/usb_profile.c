@@ -0,0 +1,257 @@
+/*******************************************************************************
+
+    Author:  Gaurav Singh
+    website: www.circuitvalley.com 
+    Created on October 28, 2017
+    
+    This file is part of Circuitvalley USB HID Bootloader.
+
+    Circuitvalley USB HID Bootloader is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Circuitvalley USB HID Bootloader is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Circuitvalley USB HID Bootloader.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "usb_profile.h"
+
+#if defined(USB_ENABLE_CYCLE_PROFILING)
+
+#define USB_PROFILE_TIMER1_FOSC_4   0x01    //TMR1CS = Fosc/4, 1:1 prescale, TMR1ON
+
+typedef struct
+{
+    uint16_t start;
+    uint16_t count;
+    uint16_t max;
+    uint32_t total;
+} USB_PROFILE_ENTRY;
+
+static USB_PROFILE_ENTRY profile[USB_PROFILE_EVENT_COUNT];
+static uint16_t profileOverhead;
+
+/** PRIVATE PROTOTYPES *********************************************/
+static uint16_t USB_ProfileNow(void);
+
+/*********************************************************************
+* Function: uint16_t USB_ProfileNow(void);
+*
+* Overview: Reads the running Timer1 value.  TMR1H is read again after
+*           TMR1L so that a carry between the two reads is not missed.
+*
+* PreCondition: USB_ProfileInitialize() was called
+*
+* Input: None
+*
+* Output: uint16_t - the current cycle count
+*
+********************************************************************/
+static uint16_t USB_ProfileNow(void)
+{
+    uint8_t high;
+    uint8_t low;
+
+    do
+    {
+        high = TMR1H;
+        low = TMR1L;
+    } while(high != TMR1H);
+
+    return ((uint16_t)high << 8) | low;
+}
+
+/*********************************************************************
+* Function: void USB_ProfileInitialize(void);
+*
+* Overview: Starts Timer1 as a free running cycle counter, measures the
+*           cost of a begin/end pair and clears the statistics.
+*
+* PreCondition: USB_ENABLE_CYCLE_PROFILING is defined
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+void USB_ProfileInitialize(void)
+{
+    uint8_t i;
+
+    T1GCON = 0x00;
+    T1CON = USB_PROFILE_TIMER1_FOSC_4;
+    PIE1bits.TMR1IE = 0;
+
+    //A begin/end pair around nothing gives the cost of the measurement
+    profileOverhead = 0;
+    USB_ProfileBegin(USB_PROFILE_DEVICE_TASKS);
+    USB_ProfileEnd(USB_PROFILE_DEVICE_TASKS);
+    profileOverhead = profile[USB_PROFILE_DEVICE_TASKS].max;
+
+    for(i = 0; i < USB_PROFILE_EVENT_COUNT; i++)
+    {
+        profile[i].count = 0;
+        profile[i].max = 0;
+        profile[i].total = 0;
+    }
+}
+
+/*********************************************************************
+* Function: void USB_ProfileBegin(USB_PROFILE_EVENT event);
+*
+* Overview: Marks the start of an event.
+*
+* PreCondition: USB_ProfileInitialize() was called
+*
+* Input: USB_PROFILE_EVENT event - the event starting
+*
+* Output: None
+*
+********************************************************************/
+void USB_ProfileBegin(USB_PROFILE_EVENT event)
+{
+    bool interruptsEnabled;
+
+    //the interrupt records its own events, keep it out of the 16 bit write
+    interruptsEnabled = INTCONbits.GIE;
+    INTCONbits.GIE = 0;
+    profile[event].start = USB_ProfileNow();
+    INTCONbits.GIE = interruptsEnabled;
+}
+
+/*********************************************************************
+* Function: void USB_ProfileEnd(USB_PROFILE_EVENT event);
+*
+* Overview: Marks the end of an event and adds its duration to the
+*           statistics of that event.
+*
+* PreCondition: USB_ProfileBegin() was called for the same event
+*
+* Input: USB_PROFILE_EVENT event - the event ending
+*
+* Output: None
+*
+********************************************************************/
+void USB_ProfileEnd(USB_PROFILE_EVENT event)
+{
+    uint16_t cycles;
+    USB_PROFILE_ENTRY* entry;
+    bool interruptsEnabled;
+
+    //GIE is already clear in the interrupt, this only matters for the
+    //events recorded from the main loop
+    interruptsEnabled = INTCONbits.GIE;
+    INTCONbits.GIE = 0;
+
+    cycles = USB_ProfileNow();
+    entry = &profile[event];
+
+    cycles -= entry->start;
+    if(cycles > profileOverhead)
+    {
+        cycles -= profileOverhead;
+    }
+    else
+    {
+        cycles = 0;
+    }
+
+    //saturate instead of wrapping, the host sees 0xFFFF events as a full table
+    if(entry->count != 0xFFFF)
+    {
+        entry->count++;
+        entry->total += cycles;
+    }
+    if(cycles > entry->max)
+    {
+        entry->max = cycles;
+    }
+
+    INTCONbits.GIE = interruptsEnabled;
+}
+
+/*********************************************************************
+* Function: void USB_ProfileReport(uint8_t* report, uint8_t first, bool clear);
+*
+* Overview: Writes the statistics of up to USB_PROFILE_REPORT_MAX_EVENTS
+*           events, starting at first, see USB_PROFILE_REPORT_SIZE for the
+*           layout.
+*
+* PreCondition: USB_ProfileInitialize() was called
+*
+* Input: uint8_t* report - receives USB_PROFILE_REPORT_SIZE bytes
+*        uint8_t first - first event to report, none past the last one
+*        bool clear - clears the statistics of the reported events once
+*                     they are copied
+*
+* Output: None
+*
+********************************************************************/
+void USB_ProfileReport(uint8_t* report, uint8_t first, bool clear)
+{
+    uint8_t i;
+    uint8_t last;
+    uint16_t count;
+    uint16_t average;
+    uint16_t max;
+    uint32_t total;
+    bool interruptsEnabled;
+
+    if(first > USB_PROFILE_EVENT_COUNT)
+    {
+        first = USB_PROFILE_EVENT_COUNT;
+    }
+    last = USB_PROFILE_EVENT_COUNT;
+    if((last - first) > USB_PROFILE_REPORT_MAX_EVENTS)
+    {
+        last = first + USB_PROFILE_REPORT_MAX_EVENTS;
+    }
+
+    *report++ = USB_PROFILE_EVENT_COUNT;
+    *report++ = first;
+    *report++ = last - first;
+
+    for(i = first; i < last; i++)
+    {
+        //the interrupt updates the same entries, take a consistent copy
+        interruptsEnabled = INTCONbits.GIE;
+        INTCONbits.GIE = 0;
+        count = profile[i].count;
+        max = profile[i].max;
+        total = profile[i].total;
+        if(clear == true)
+        {
+            profile[i].count = 0;
+            profile[i].max = 0;
+            profile[i].total = 0;
+        }
+        INTCONbits.GIE = interruptsEnabled;
+
+        average = 0;
+        if(count != 0)
+        {
+            average = total / count;
+        }
+
+        *report++ = count;
+        *report++ = count >> 8;
+        *report++ = average;
+        *report++ = average >> 8;
+        *report++ = max;
+        *report++ = max >> 8;
+    }
+}
+
+#endif //USB_ENABLE_CYCLE_PROFILING
@@ -0,0 +1,149 @@
+/*******************************************************************************
+
+    Author:  Gaurav Singh
+    website: www.circuitvalley.com 
+    Created on October 28, 2017
+    
+    This file is part of Circuitvalley USB HID Bootloader.
+
+    Circuitvalley USB HID Bootloader is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Circuitvalley USB HID Bootloader is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Circuitvalley USB HID Bootloader.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+
+#ifndef USB_PROFILE_H
+#define USB_PROFILE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "usb_config.h"
+
+/*** USB Stack Cycle Profiling ****************************************/
+//With USB_ENABLE_CYCLE_PROFILING defined in usb_config.h, Timer1 runs free
+//at Fosc/4 (one count per instruction cycle, 12 per microsecond) and the
+//hot paths of the device stack are timed as the events below.  Every event
+//keeps a count, the longest and the total duration, with the cost of the
+//measurement itself removed.  A duration must stay under 65536 cycles
+//(about 5.4ms) to be measured correctly.
+//
+//Events timed from the main loop (USB_PROFILE_TRANSFER_ONE_PACKET) include
+//any interrupt that lands inside them, so compare their averages rather
+//than their maximums between releases.  The statistics are updated with
+//interrupts masked, so an event recorded by the interrupt never corrupts one
+//being recorded by the main loop.  USBTransferOnePacket() is also called from
+//the interrupt (endpoint arming on EVENT_CONFIGURED); if that lands inside a
+//main loop USBTransferOnePacket(), the main loop one is timed from the end
+//of the nested call.
+//
+//Without USB_ENABLE_CYCLE_PROFILING the macros compile to nothing and
+//Timer1 is left alone.
+typedef enum
+{
+    USB_PROFILE_DEVICE_TASKS = 0,       //USBDeviceTasks(), the whole interrupt
+    USB_PROFILE_SETUP,                  //EP0 SETUP transaction
+    USB_PROFILE_CONTROL_OUT,            //EP0 OUT data/status transaction
+    USB_PROFILE_CONTROL_IN,             //EP0 IN data/status transaction
+    USB_PROFILE_TRANSFER_IN,            //IN transaction complete on any other endpoint
+    USB_PROFILE_TRANSFER_OUT,           //OUT transaction complete on any other endpoint
+    USB_PROFILE_SOF,                    //start of frame
+    USB_PROFILE_SUSPEND,                //USBSuspend()
+    USB_PROFILE_WAKE,                   //USBWakeFromSuspend()
+    USB_PROFILE_TRANSFER_ONE_PACKET,    //USBTransferOnePacket()
+    USB_PROFILE_CONTROL_TX_SERVICE,     //USBCtrlTrfTxService()
+    USB_PROFILE_EVENT_COUNT
+} USB_PROFILE_EVENT;
+
+//Report written by USB_ProfileReport(): [0] USB_PROFILE_EVENT_COUNT, [1] the
+//first event reported, [2] the number of events reported, then for each of
+//them in USB_PROFILE_EVENT order its count, average and maximum in cycles,
+//each 16 bits, low byte first.  All the events do not fit in one 64 byte
+//report, so the host reads them in pages of up to
+//USB_PROFILE_REPORT_MAX_EVENTS, starting each page at the next event.
+#define USB_PROFILE_EVENT_REPORT_SIZE   6
+#define USB_PROFILE_REPORT_MAX_EVENTS   10
+#define USB_PROFILE_REPORT_SIZE         (3 + (USB_PROFILE_REPORT_MAX_EVENTS * USB_PROFILE_EVENT_REPORT_SIZE))
+
+#if defined(USB_ENABLE_CYCLE_PROFILING)
+    #define USB_PROFILE_BEGIN(event)    USB_ProfileBegin(event)
+    #define USB_PROFILE_END(event)      USB_ProfileEnd(event)
+#else
+    #define USB_PROFILE_BEGIN(event)
+    #define USB_PROFILE_END(event)
+#endif
+
+/*********************************************************************
+* Function: void USB_ProfileInitialize(void);
+*
+* Overview: Starts Timer1 as a free running cycle counter, measures the
+*           cost of a begin/end pair and clears the statistics.
+*
+* PreCondition: USB_ENABLE_CYCLE_PROFILING is defined
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+void USB_ProfileInitialize(void);
+
+/*********************************************************************
+* Function: void USB_ProfileBegin(USB_PROFILE_EVENT event);
+*
+* Overview: Marks the start of an event.
+*
+* PreCondition: USB_ProfileInitialize() was called
+*
+* Input: USB_PROFILE_EVENT event - the event starting
+*
+* Output: None
+*
+********************************************************************/
+void USB_ProfileBegin(USB_PROFILE_EVENT event);
+
+/*********************************************************************
+* Function: void USB_ProfileEnd(USB_PROFILE_EVENT event);
+*
+* Overview: Marks the end of an event and adds its duration to the
+*           statistics of that event.
+*
+* PreCondition: USB_ProfileBegin() was called for the same event
+*
+* Input: USB_PROFILE_EVENT event - the event ending
+*
+* Output: None
+*
+********************************************************************/
+void USB_ProfileEnd(USB_PROFILE_EVENT event);
+
+/*********************************************************************
+* Function: void USB_ProfileReport(uint8_t* report, uint8_t first, bool clear);
+*
+* Overview: Writes the statistics of up to USB_PROFILE_REPORT_MAX_EVENTS
+*           events, starting at first, see USB_PROFILE_REPORT_SIZE for the
+*           layout.
+*
+* PreCondition: USB_ProfileInitialize() was called
+*
+* Input: uint8_t* report - receives USB_PROFILE_REPORT_SIZE bytes
+*        uint8_t first - first event to report, none past the last one
+*        bool clear - clears the statistics of the reported events once
+*                     they are copied
+*
+* Output: None
+*
+********************************************************************/
+void USB_ProfileReport(uint8_t* report, uint8_t first, bool clear);
+
+#endif //USB_PROFILE_H
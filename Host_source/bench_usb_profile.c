@@ -0,0 +1,270 @@
+/*******************************************************************************
+
+    Author:  Gaurav Singh
+    website: www.circuitvalley.com
+    Created on October 28, 2017
+
+    This file is part of Circuitvalley USB HID Bootloader.
+
+    Circuitvalley USB HID Bootloader is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Circuitvalley USB HID Bootloader is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Circuitvalley USB HID Bootloader.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+
+
+
+/*** USB Stack Benchmark ***********************************************/
+//Times the USB stack hot paths with the firmware's own profiler
+//(Firmware_source/usb_profile.c, built with USB_ENABLE_CYCLE_PROFILING) on
+//the sim harness of test_custom_hid.c.  The workload enumerates the device
+//again and again, runs COMMAND_READ_ADC_WITH_PWM round trips with a start
+//of frame between them and suspends and resumes the bus, then reads the
+//statistics back with COMMAND_GET_USB_PROFILE like the PC tool does and
+//prints them.
+//
+//sim/sim_xc.c counts Timer1 from the host's cycle counter for this
+//(simTimer1HostClock), so the figures are host CPU cycles and not PIC
+//instruction cycles: compare them between two builds of the same host to
+//see what a change to the stack costs or saves, and check the absolute
+//numbers on the board with COMMAND_GET_USB_PROFILE.  A host interrupt
+//inside an event shows up in its maximum, so compare the averages.
+//
+//Build and run from the repository root:
+//  make -C Host_source bench
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <xc.h>
+#include "sim_usb.h"
+#include "system.h"
+#include "pwm.h"
+#include "app_device_custom_hid.h"
+#include "adc.h"
+#include "usart.h"
+#include "scheduler.h"
+#include "boot_request.h"
+#include "usb.h"
+#include "usb_profile.h"
+
+#define BENCH_REPORT_SIZE       64
+#define BENCH_ENUMERATIONS      100
+#define BENCH_ROUND_TRIPS       1000
+#define BENCH_SUSPEND_INTERVAL  100
+
+/** PRIVATE PROTOTYPES *********************************************/
+static bool BENCH_RoundTrip(uint16_t pwm);
+static bool BENCH_Report(void);
+
+/*********************************************************************
+* Function: bool BENCH_RoundTrip(uint16_t pwm);
+*
+* Overview: Sends one COMMAND_READ_ADC_WITH_PWM, runs the application
+*           like the main loop and reads the reply, with a start of frame
+*           in between.
+*
+* PreCondition: The device is configured
+*
+* Input: uint16_t pwm - 10-bit duty cycle sent with the command
+*
+* Output: bool - true if the reply came back
+*
+********************************************************************/
+static bool BENCH_RoundTrip(uint16_t pwm)
+{
+    uint8_t report[BENCH_REPORT_SIZE];
+    uint8_t length;
+
+    memset(report, 0, sizeof(report));
+    report[0] = COMMAND_READ_ADC_WITH_PWM;
+    report[1] = (uint8_t)pwm;
+    report[2] = (uint8_t)(pwm >> 8);
+
+    if(SIM_UsbHostOut(CUSTOM_DEVICE_HID_EP, report, sizeof(report)) != SIM_USB_ACK)
+    {
+        return false;
+    }
+    APP_DeviceCustomHIDTasks();
+    SIM_UsbStartOfFrame();
+
+    if(SIM_UsbHostIn(CUSTOM_DEVICE_HID_EP, report, &length) != SIM_USB_ACK)
+    {
+        return false;
+    }
+    return (report[0] == COMMAND_READ_ADC_WITH_PWM);
+}
+
+/*********************************************************************
+* Function: bool BENCH_Report(void);
+*
+* Overview: Reads every page of COMMAND_GET_USB_PROFILE and prints the
+*           count, average and maximum of each event.
+*
+* PreCondition: The device is configured
+*
+* Input: None
+*
+* Output: bool - true if every page came back
+*
+********************************************************************/
+static bool BENCH_Report(void)
+{
+    static const char* const names[USB_PROFILE_EVENT_COUNT] =
+    {
+        "DEVICE_TASKS", "SETUP", "CONTROL_OUT", "CONTROL_IN", "TRANSFER_IN",
+        "TRANSFER_OUT", "SOF", "SUSPEND", "WAKE", "TRANSFER_ONE_PACKET",
+        "CONTROL_TX_SERVICE"
+    };
+    uint8_t report[BENCH_REPORT_SIZE];
+    uint8_t length;
+    uint8_t first;
+    uint8_t i;
+    const uint8_t* entry;
+
+    printf("%-20s %8s %8s %8s\n", "event", "count", "average", "max");
+
+    first = 0;
+    while(first < USB_PROFILE_EVENT_COUNT)
+    {
+        memset(report, 0, sizeof(report));
+        report[0] = COMMAND_GET_USB_PROFILE;
+        report[1] = 0;
+        report[2] = first;
+
+        if(SIM_UsbHostOut(CUSTOM_DEVICE_HID_EP, report, sizeof(report)) != SIM_USB_ACK)
+        {
+            return false;
+        }
+        APP_DeviceCustomHIDTasks();
+        if((SIM_UsbHostIn(CUSTOM_DEVICE_HID_EP, report, &length) != SIM_USB_ACK) ||
+           (report[0] != COMMAND_GET_USB_PROFILE) || (report[1] != USB_PROFILE_EVENT_COUNT) ||
+           (report[2] != first) || (report[3] == 0))
+        {
+            return false;
+        }
+
+        for(i = 0; i < report[3]; i++)
+        {
+            entry = &report[4 + (i * USB_PROFILE_EVENT_REPORT_SIZE)];
+            printf("%-20s %8u %8u %8u\n", names[first + i],
+                   entry[0] | ((unsigned int)entry[1] << 8),
+                   entry[2] | ((unsigned int)entry[3] << 8),
+                   entry[4] | ((unsigned int)entry[5] << 8));
+        }
+        first += report[3];
+    }
+    return true;
+}
+
+/** STUBS **********************************************************/
+//The application calls these, the benchmark does not look at them.
+
+uint16_t SCHEDULER_Milliseconds(void)
+{
+    return 0;
+}
+
+void BOOT_EnterBootloader(void)
+{
+}
+
+void SYSTEM_Initialize(SYSTEM_STATE state)
+{
+}
+
+void USART_SetBaudRate(uint32_t baudRate)
+{
+}
+
+void USART_Initialize()
+{
+}
+
+uint8_t USART_TxFree(void)
+{
+    return 0;
+}
+
+uint8_t USART_RxCount(void)
+{
+    return 0;
+}
+
+uint8_t USART_WriteBuffer(const uint8_t* data, uint8_t length)
+{
+    return 0;
+}
+
+uint8_t USART_ReadBuffer(uint8_t* data, uint8_t length)
+{
+    return 0;
+}
+
+void USART_GetStatistics(USART_STATISTICS* statistics, bool clear)
+{
+    memset(statistics, 0, sizeof(*statistics));
+}
+
+int main(void)
+{
+    unsigned int i;
+
+    ADC_SetConfiguration(ADC_CONFIGURATION_DEFAULT);
+    PWM_SetConfiguration(PWM_CONFIGURATION_DEFAULT);
+    PWM_Enable(PWM_CHANNEL_1);
+    ADC_Enable(ADC_CHANNEL_INPUT);
+
+    //the first begin/end pair runs cold, measure the overhead once warm
+    simTimer1HostClock = true;
+    USB_ProfileInitialize();
+    USB_ProfileInitialize();
+
+    USBDeviceInit();
+    USBDeviceAttach();
+
+    for(i = 0; i < BENCH_ENUMERATIONS; i++)
+    {
+        SIM_UsbBusReset();
+        if(SIM_UsbEnumerate() == false)
+        {
+            printf("bench_usb_profile: enumeration failed\n");
+            return 1;
+        }
+    }
+
+    for(i = 0; i < BENCH_ROUND_TRIPS; i++)
+    {
+        if(BENCH_RoundTrip((uint16_t)(i & 0x3FF)) == false)
+        {
+            printf("bench_usb_profile: round trip %u failed\n", i);
+            return 1;
+        }
+        if((i % BENCH_SUSPEND_INTERVAL) == (BENCH_SUSPEND_INTERVAL - 1))
+        {
+            SIM_UsbSuspend();
+            SIM_UsbResume();
+        }
+    }
+
+    printf("bench_usb_profile: %u enumerations, %u round trips, host cycles\n",
+           BENCH_ENUMERATIONS, BENCH_ROUND_TRIPS);
+    if(BENCH_Report() == false)
+    {
+        printf("bench_usb_profile: COMMAND_GET_USB_PROFILE failed\n");
+        return 1;
+    }
+    return 0;
+}
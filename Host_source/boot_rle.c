@@ -0,0 +1,235 @@
+/*******************************************************************************
+
+    Author:  Gaurav Singh
+    website: www.circuitvalley.com 
+    Created on October 28, 2017
+    
+    This file is part of Circuitvalley USB HID Bootloader.
+
+    Circuitvalley USB HID Bootloader is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Circuitvalley USB HID Bootloader is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Circuitvalley USB HID Bootloader.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "boot_rle.h"
+
+//A run shorter than this is cheaper to leave inside a literal
+#define BOOT_RLE_MIN_RUN    3
+
+/** PRIVATE PROTOTYPES *********************************************/
+static size_t BOOT_RleRunLength(const uint16_t* words, size_t count);
+
+/*********************************************************************
+* Function: size_t BOOT_RleRunLength(const uint16_t* words, size_t count);
+*
+* Overview: Counts how many words from words[0] on are equal, up to
+*           BOOT_RLE_MAX_WORDS.
+*
+* PreCondition: count != 0
+*
+* Input: const uint16_t* words - first word
+*        size_t count - number of words available
+*
+* Output: size_t - length of the run, at least 1
+*
+********************************************************************/
+static size_t BOOT_RleRunLength(const uint16_t* words, size_t count)
+{
+    size_t length;
+
+    length = 1;
+    while((length < count) && (length < BOOT_RLE_MAX_WORDS) && (words[length] == words[0]))
+    {
+        length++;
+    }
+    return length;
+}
+
+/*********************************************************************
+* Function: size_t BOOT_RleEncode(const uint16_t* words, size_t count, uint8_t* out, size_t outSize, size_t* consumed);
+*
+* Overview: Encodes as many whole tokens as fit in outSize bytes, starting
+*           at the first of count words.
+*
+* PreCondition: none
+*
+* Input: const uint16_t* words - image words (blank words as 0xFFFF)
+*        size_t count - number of words available
+*        uint8_t* out - receives the token bytes
+*        size_t outSize - room in out
+*        size_t* consumed - receives the number of words encoded
+*
+* Output: size_t - number of token bytes written
+*
+********************************************************************/
+size_t BOOT_RleEncode(const uint16_t* words, size_t count, uint8_t* out, size_t outSize, size_t* consumed)
+{
+    size_t position;
+    size_t written;
+    size_t length;
+    size_t i;
+
+    position = 0;
+    written = 0;
+
+    while(position < count)
+    {
+        length = BOOT_RleRunLength(&words[position], count - position);
+        if(length >= BOOT_RLE_MIN_RUN)
+        {
+            if((outSize - written) < 3)
+            {
+                break;
+            }
+            out[written++] = (uint8_t)(BOOT_RLE_RUN_FLAG | (length - 1));
+            out[written++] = (uint8_t)words[position];
+            out[written++] = (uint8_t)(words[position] >> 8);
+            position += length;
+            continue;
+        }
+
+        //Literal: take words up to the next worthwhile run, the token limit
+        //or the room left
+        if((outSize - written) < 3)
+        {
+            break;
+        }
+        length = 0;
+        while(((position + length) < count) && (length < BOOT_RLE_MAX_WORDS)
+            && ((1 + ((length + 1) * 2)) <= (outSize - written))
+            && (BOOT_RleRunLength(&words[position + length], count - position - length) < BOOT_RLE_MIN_RUN))
+        {
+            length++;
+        }
+
+        out[written++] = (uint8_t)(length - 1);
+        for(i = 0; i < length; i++)
+        {
+            out[written++] = (uint8_t)words[position + i];
+            out[written++] = (uint8_t)(words[position + i] >> 8);
+        }
+        position += length;
+    }
+
+    *consumed = position;
+    return written;
+}
+
+/*********************************************************************
+* Function: size_t BOOT_RleBuildPacket(uint8_t* packet, uint32_t address, const uint16_t* words, size_t count);
+*
+* Overview: Builds one complete PROGRAM_DEVICE_RLE packet for the words
+*           starting at the byte address address.
+*
+* PreCondition: none
+*
+* Input: uint8_t* packet - receives BOOT_RLE_PACKET_SIZE bytes
+*        uint32_t address - byte address of words[0] (twice the word address)
+*        const uint16_t* words - image words (blank words as 0xFFFF)
+*        size_t count - number of words available
+*
+* Output: size_t - number of words the packet carries, the next packet
+*                  starts at address + 2 * that
+*
+********************************************************************/
+size_t BOOT_RleBuildPacket(uint8_t* packet, uint32_t address, const uint16_t* words, size_t count)
+{
+    uint8_t tokens[BOOT_RLE_DATA_SIZE];
+    size_t size;
+    size_t consumed;
+    size_t i;
+
+    size = BOOT_RleEncode(words, count, tokens, sizeof(tokens), &consumed);
+
+    packet[0] = BOOT_RLE_COMMAND;
+    packet[1] = (uint8_t)address;
+    packet[2] = (uint8_t)(address >> 8);
+    packet[3] = (uint8_t)(address >> 16);
+    packet[4] = (uint8_t)(address >> 24);
+    packet[5] = (uint8_t)size;
+
+    for(i = 0; i < (BOOT_RLE_DATA_SIZE - size); i++)
+    {
+        packet[BOOT_RLE_HEADER_SIZE + i] = 0;
+    }
+    for(i = 0; i < size; i++)
+    {
+        packet[BOOT_RLE_PACKET_SIZE - size + i] = tokens[i];
+    }
+
+    return consumed;
+}
+
+/*********************************************************************
+* Function: size_t BOOT_RleDecode(const uint8_t* in, size_t size, uint16_t* words, size_t maxWords);
+*
+* Overview: Decodes token bytes the way the bootloader does, dropping a
+*           token cut short by the end of the data.
+*
+* PreCondition: none
+*
+* Input: const uint8_t* in - token bytes
+*        size_t size - number of token bytes
+*        uint16_t* words - receives the decoded words
+*        size_t maxWords - room in words
+*
+* Output: size_t - number of words decoded
+*
+********************************************************************/
+size_t BOOT_RleDecode(const uint8_t* in, size_t size, uint16_t* words, size_t maxWords)
+{
+    size_t position;
+    size_t decoded;
+    unsigned int count;
+    uint8_t token;
+
+    position = 0;
+    decoded = 0;
+
+    while(position < size)
+    {
+        token = in[position++];
+        count = (token & BOOT_RLE_COUNT_MASK) + 1;
+
+        if(token & BOOT_RLE_RUN_FLAG)
+        {
+            if((position + 2) > size)
+            {
+                break;
+            }
+            while((count-- != 0) && (decoded < maxWords))
+            {
+                words[decoded++] = (uint16_t)(in[position] | (in[position + 1] << 8));
+            }
+            position += 2;
+        }
+        else
+        {
+            while(count-- != 0)
+            {
+                if(((position + 2) > size) || (decoded >= maxWords))
+                {
+                    return decoded;
+                }
+                words[decoded++] = (uint16_t)(in[position] | (in[position + 1] << 8));
+                position += 2;
+            }
+        }
+    }
+
+    return decoded;
+}
@@ -0,0 +1,110 @@
+/*******************************************************************************
+
+    Author:  Gaurav Singh
+    website: www.circuitvalley.com 
+    Created on October 28, 2017
+    
+    This file is part of Circuitvalley USB HID Bootloader.
+
+    Circuitvalley USB HID Bootloader is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Circuitvalley USB HID Bootloader is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Circuitvalley USB HID Bootloader.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+
+#ifndef BOOT_RLE_H
+#define BOOT_RLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*** PROGRAM_DEVICE_RLE Packet Definitions ****************************/
+//Host side encoder for the bootloader PROGRAM_DEVICE_RLE command (see
+//ProgramRlePacket() in USB_Bootloader_source/src/BootRle.inc, only
+//present when the bootloader is built with ENABLE_PROGRAM_DEVICE_RLE_COMMAND).
+//The packet is laid out like PROGRAM_DEVICE:
+//
+//  [0]      BOOT_RLE_COMMAND
+//  [1..4]   byte address of the first decoded byte, low byte first
+//  [5]      number of token bytes
+//  [6..63]  token bytes, right justified (unused bytes first)
+//
+//Each token is a header byte followed by 16-bit words, low byte first:
+//  0x00-0x7F  literal, (header + 1) words follow
+//  0x80-0xFF  run, one word follows, repeated ((header & 0x7F) + 1) times
+//Tokens never span packets.
+#define BOOT_RLE_COMMAND        0x11
+#define BOOT_RLE_PACKET_SIZE    64
+#define BOOT_RLE_HEADER_SIZE    6
+#define BOOT_RLE_DATA_SIZE      (BOOT_RLE_PACKET_SIZE - BOOT_RLE_HEADER_SIZE)
+#define BOOT_RLE_RUN_FLAG       0x80
+#define BOOT_RLE_COUNT_MASK     0x7F
+#define BOOT_RLE_MAX_WORDS      (BOOT_RLE_COUNT_MASK + 1)
+
+/*********************************************************************
+* Function: size_t BOOT_RleEncode(const uint16_t* words, size_t count, uint8_t* out, size_t outSize, size_t* consumed);
+*
+* Overview: Encodes as many whole tokens as fit in outSize bytes, starting
+*           at the first of count words.
+*
+* PreCondition: none
+*
+* Input: const uint16_t* words - image words (blank words as 0xFFFF)
+*        size_t count - number of words available
+*        uint8_t* out - receives the token bytes
+*        size_t outSize - room in out
+*        size_t* consumed - receives the number of words encoded
+*
+* Output: size_t - number of token bytes written
+*
+********************************************************************/
+size_t BOOT_RleEncode(const uint16_t* words, size_t count, uint8_t* out, size_t outSize, size_t* consumed);
+
+/*********************************************************************
+* Function: size_t BOOT_RleBuildPacket(uint8_t* packet, uint32_t address, const uint16_t* words, size_t count);
+*
+* Overview: Builds one complete PROGRAM_DEVICE_RLE packet for the words
+*           starting at the byte address address.
+*
+* PreCondition: none
+*
+* Input: uint8_t* packet - receives BOOT_RLE_PACKET_SIZE bytes
+*        uint32_t address - byte address of words[0] (twice the word address)
+*        const uint16_t* words - image words (blank words as 0xFFFF)
+*        size_t count - number of words available
+*
+* Output: size_t - number of words the packet carries, the next packet
+*                  starts at address + 2 * that
+*
+********************************************************************/
+size_t BOOT_RleBuildPacket(uint8_t* packet, uint32_t address, const uint16_t* words, size_t count);
+
+/*********************************************************************
+* Function: size_t BOOT_RleDecode(const uint8_t* in, size_t size, uint16_t* words, size_t maxWords);
+*
+* Overview: Decodes token bytes the way the bootloader does, dropping a
+*           token cut short by the end of the data.
+*
+* PreCondition: none
+*
+* Input: const uint8_t* in - token bytes
+*        size_t size - number of token bytes
+*        uint16_t* words - receives the decoded words
+*        size_t maxWords - room in words
+*
+* Output: size_t - number of words decoded
+*
+********************************************************************/
+size_t BOOT_RleDecode(const uint8_t* in, size_t size, uint16_t* words, size_t maxWords);
+
+#endif //BOOT_RLE_H
@@ -0,0 +1,98 @@
+/*******************************************************************************
+
+    Author:  Gaurav Singh
+    website: www.circuitvalley.com 
+    Created on October 28, 2017
+    
+    This file is part of Circuitvalley USB HID Bootloader.
+
+    Circuitvalley USB HID Bootloader is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Circuitvalley USB HID Bootloader is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Circuitvalley USB HID Bootloader.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "sample_decode.h"
+
+/*********************************************************************
+* Function: void SAMPLE_DecodeReport(const uint8_t* report, SAMPLE_REPORT* decoded);
+*
+* Overview: Unpacks one 64 byte stream report as read from the device,
+*           either packed (48 samples) or wide (30 oversampled samples).
+*
+* PreCondition: none
+*
+* Input: const uint8_t* report - the 64 byte IN report
+*        SAMPLE_REPORT* decoded - receives the header, the sample count
+*                                 and the samples
+*
+* Output: None
+*
+********************************************************************/
+void SAMPLE_DecodeReport(const uint8_t* report, SAMPLE_REPORT* decoded)
+{
+    const uint8_t* group;
+    uint16_t* samples;
+    unsigned int i;
+    unsigned int j;
+
+    decoded->type = report[0];
+    decoded->sequence = report[1];
+    decoded->timestamp = (uint16_t)(report[2] | (report[3] << 8));
+
+    if(decoded->type == SAMPLE_REPORT_STREAM_DATA_WIDE)
+    {
+        decoded->count = SAMPLE_WIDE_SAMPLES_PER_REPORT;
+        for(i = 0; i < SAMPLE_WIDE_SAMPLES_PER_REPORT; i++)
+        {
+            decoded->samples[i] = (uint16_t)(report[SAMPLE_PACK_HEADER_SIZE + (i * 2)] | (report[SAMPLE_PACK_HEADER_SIZE + (i * 2) + 1] << 8));
+        }
+        return;
+    }
+
+    decoded->count = SAMPLE_PACK_SAMPLES_PER_REPORT;
+    group = &report[SAMPLE_PACK_HEADER_SIZE];
+    samples = &decoded->samples[0];
+    for(i = 0; i < SAMPLE_PACK_GROUPS_PER_REPORT; i++)
+    {
+        for(j = 0; j < SAMPLE_PACK_GROUP_SAMPLES; j++)
+        {
+            samples[j] = (uint16_t)(group[j] | (((group[4] >> (j * 2)) & 0x03) << 8));
+        }
+        group += SAMPLE_PACK_GROUP_SIZE;
+        samples += SAMPLE_PACK_GROUP_SAMPLES;
+    }
+}
+
+/*********************************************************************
+* Function: uint16_t SAMPLE_DroppedBetween(const SAMPLE_REPORT* previous, const SAMPLE_REPORT* next);
+*
+* Overview: Returns how many samples the device dropped between the
+*           last sample of previous and the first sample of next.  The
+*           firmware only reports the index of the first sample, so any
+*           gap inside previous is included in the result.
+*
+* PreCondition: next is the report received right after previous
+*
+* Input: const SAMPLE_REPORT* previous - earlier report
+*        const SAMPLE_REPORT* next - following report
+*
+* Output: uint16_t - number of samples missing between the two
+*
+********************************************************************/
+uint16_t SAMPLE_DroppedBetween(const SAMPLE_REPORT* previous, const SAMPLE_REPORT* next)
+{
+    return (uint16_t)(next->timestamp - previous->timestamp - previous->count);
+}
@@ -0,0 +1,89 @@
+/*******************************************************************************
+
+    Author:  Gaurav Singh
+    website: www.circuitvalley.com 
+    Created on October 28, 2017
+    
+    This file is part of Circuitvalley USB HID Bootloader.
+
+    Circuitvalley USB HID Bootloader is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Circuitvalley USB HID Bootloader is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Circuitvalley USB HID Bootloader.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+#ifndef SAMPLE_DECODE_H
+#define SAMPLE_DECODE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*** Packed Sample Report Definitions ********************************/
+//Host side mirror of Firmware_source/sample_pack.h.  A packed report is a
+//4 byte header (type, sequence, timestamp low, timestamp high) followed by
+//12 groups of four 10-bit samples stored in five bytes.
+#define SAMPLE_REPORT_SIZE              64
+#define SAMPLE_PACK_HEADER_SIZE         4
+#define SAMPLE_PACK_GROUP_SAMPLES       4
+#define SAMPLE_PACK_GROUP_SIZE          5
+#define SAMPLE_PACK_GROUPS_PER_REPORT   ((SAMPLE_REPORT_SIZE - SAMPLE_PACK_HEADER_SIZE) / SAMPLE_PACK_GROUP_SIZE)
+#define SAMPLE_PACK_SAMPLES_PER_REPORT  (SAMPLE_PACK_GROUPS_PER_REPORT * SAMPLE_PACK_GROUP_SAMPLES)
+
+#define SAMPLE_WIDE_SAMPLES_PER_REPORT  ((SAMPLE_REPORT_SIZE - SAMPLE_PACK_HEADER_SIZE) / 2)
+
+#define SAMPLE_REPORT_STREAM_DATA       0x85    //packed 10-bit samples
+#define SAMPLE_REPORT_STREAM_DATA_WIDE  0x8B    //oversampled samples, 16 bits each
+
+typedef struct
+{
+    uint8_t type;
+    uint8_t sequence;
+    uint16_t timestamp;
+    uint8_t count;
+    uint16_t samples[SAMPLE_PACK_SAMPLES_PER_REPORT];
+} SAMPLE_REPORT;
+
+/*********************************************************************
+* Function: void SAMPLE_DecodeReport(const uint8_t* report, SAMPLE_REPORT* decoded);
+*
+* Overview: Unpacks one 64 byte stream report as read from the device,
+*           either packed (48 samples) or wide (30 oversampled samples).
+*
+* PreCondition: none
+*
+* Input: const uint8_t* report - the 64 byte IN report
+*        SAMPLE_REPORT* decoded - receives the header, the sample count
+*                                 and the samples
+*
+* Output: None
+*
+********************************************************************/
+void SAMPLE_DecodeReport(const uint8_t* report, SAMPLE_REPORT* decoded);
+
+/*********************************************************************
+* Function: uint16_t SAMPLE_DroppedBetween(const SAMPLE_REPORT* previous, const SAMPLE_REPORT* next);
+*
+* Overview: Returns how many samples the device dropped between the
+*           last sample of previous and the first sample of next, judged
+*           from the timestamps.
+*
+* PreCondition: next is the report received right after previous
+*
+* Input: const SAMPLE_REPORT* previous - earlier report
+*        const SAMPLE_REPORT* next - following report
+*
+* Output: uint16_t - number of samples missing between the two
+*
+********************************************************************/
+uint16_t SAMPLE_DroppedBetween(const SAMPLE_REPORT* previous, const SAMPLE_REPORT* next);
+
+#endif //SAMPLE_DECODE_H
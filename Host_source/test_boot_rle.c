@@ -0,0 +1,418 @@
+/*******************************************************************************
+
+    Author:  Gaurav Singh
+    website: www.circuitvalley.com 
+    Created on October 28, 2017
+    
+    This file is part of Circuitvalley USB HID Bootloader.
+
+    Circuitvalley USB HID Bootloader is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Circuitvalley USB HID Bootloader is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Circuitvalley USB HID Bootloader.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+/*** PROGRAM_DEVICE_RLE Round-Trip Test *******************************/
+//Encodes program images into PROGRAM_DEVICE_RLE packets with boot_rle.c and
+//decodes every packet twice: with BOOT_RleDecode(), and with the
+//bootloader's own ProgramRlePacket() (USB_Bootloader_source/src/BootRle.inc,
+//compiled in here) working on the packet as the bootloader receives it.  The
+//bootloader globals it uses are defined below and WriteFlashBlock() is
+//stubbed to collect the programmed words.  Both must give back the image,
+//and each packet must start at the address where the previous one ended.  Covered: runs and literals longer than a
+//token and crossing packet boundaries, an erased row (all 0xFFFF, which the
+//bootloader writes as 0x3FFF) and an all-0x3FFF row, a token cut short by
+//the end of the data, and pseudo random images.
+//
+//Build and run from the repository root:
+//  make -C Host_source test
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "boot_rle.h"
+#include "test_common.h"
+
+#define TEST_ROW_WORDS      32          //ERASE_PAGE_NUM_WORDS on the PIC16F145x
+#define TEST_MAX_WORDS      4096
+#define TEST_START_ADDRESS  0x1200      //byte address of the first packet
+
+//What BootRle.inc needs from BootPIC16F145x.c
+#define REQUEST_DATA_BLOCK_SIZE     BOOT_RLE_DATA_SIZE
+#define WRITE_BLOCK_SIZE            0x40
+#define INVALID_ADDRESS             0xFFFFFFFF
+
+/** VARIABLES ******************************************************/
+static uint16_t image[TEST_MAX_WORDS];
+static uint16_t decoded[TEST_MAX_WORDS];
+static uint16_t programmed[TEST_MAX_WORDS];
+
+//the bootloader globals ProgramRlePacket() works on, PacketFromPC only with
+//the fields of the PROGRAM_DEVICE layout it reads
+static struct
+{
+    unsigned char Size;
+    unsigned char Data[REQUEST_DATA_BLOCK_SIZE];
+} PacketFromPC;
+static unsigned char BufferedDataIndex;
+static unsigned int ProgrammedPointer;
+static unsigned char ProgrammingBuffer[WRITE_BLOCK_SIZE];
+
+/** PRIVATE PROTOTYPES *********************************************/
+void WriteFlashBlock(void);
+void BufferProgramByte(unsigned char Byte);
+void ProgramRlePacket(void);
+static void TEST_ProgramRlePacket(const uint8_t* packet);
+static void TEST_ProgramComplete(void);
+static unsigned int TEST_RoundTrip(const uint16_t* words, size_t count);
+static void TEST_RunsAcrossPackets(void);
+static void TEST_ErasedRows(void);
+static void TEST_CutToken(void);
+static void TEST_Random(void);
+
+#include "BootRle.inc"
+
+/*********************************************************************
+* Function: void WriteFlashBlock(void);
+*
+* Overview: Stands in for the bootloader's WriteFlashBlock(): stores the
+*           buffered bytes, low byte first, at the word address they were
+*           collected for, masked to the 14 bit flash word like a write
+*           to PMDATH/PMDATL, and empties the buffer.
+*
+* PreCondition: none
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+void WriteFlashBlock(void)
+{
+    unsigned int word;
+    unsigned char i;
+
+    word = ((ProgrammedPointer - BufferedDataIndex) - TEST_START_ADDRESS) >> 1;
+    for(i = 0; (i + 1) < BufferedDataIndex; i += 2)
+    {
+        if(word < TEST_MAX_WORDS)
+        {
+            programmed[word] = (uint16_t)((ProgrammingBuffer[i] | (ProgrammingBuffer[i + 1] << 8)) & 0x3FFF);
+        }
+        word++;
+    }
+    BufferedDataIndex = 0;
+}
+
+/*********************************************************************
+* Function: void TEST_ProgramRlePacket(const uint8_t* packet);
+*
+* Overview: Handles a whole 64 byte PROGRAM_DEVICE_RLE packet like the
+*           bootloader's ProcessIO(): takes the address of the first
+*           packet, checks that the next ones continue from it, and runs
+*           ProgramRlePacket() on Size at [5] and Data in [6..63].
+*
+* PreCondition: none
+*
+* Input: const uint8_t* packet - a PROGRAM_DEVICE_RLE packet
+*
+* Output: None
+*
+********************************************************************/
+static void TEST_ProgramRlePacket(const uint8_t* packet)
+{
+    unsigned int address;
+
+    address = packet[1] | (packet[2] << 8);
+    if(ProgrammedPointer == (unsigned int)INVALID_ADDRESS)
+    {
+        ProgrammedPointer = address;
+    }
+    TEST_CHECK(ProgrammedPointer == address);
+
+    PacketFromPC.Size = packet[5];
+    memcpy(PacketFromPC.Data, &packet[BOOT_RLE_HEADER_SIZE], REQUEST_DATA_BLOCK_SIZE);
+    ProgramRlePacket();
+}
+
+/*********************************************************************
+* Function: void TEST_ProgramComplete(void);
+*
+* Overview: PROGRAM_COMPLETE: writes what is left in the buffer and
+*           forgets the address.
+*
+* PreCondition: none
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+static void TEST_ProgramComplete(void)
+{
+    WriteFlashBlock();
+    ProgrammedPointer = (unsigned int)INVALID_ADDRESS;
+}
+
+/*********************************************************************
+* Function: unsigned int TEST_RoundTrip(const uint16_t* words, size_t count);
+*
+* Overview: Sends words as PROGRAM_DEVICE_RLE packets from byte address
+*           0x1200 (word 0x900) and checks that both decoders give them
+*           back, as the bootloader would program them.
+*
+* PreCondition: count <= TEST_MAX_WORDS
+*
+* Input: const uint16_t* words - image words (blank words as 0xFFFF)
+*        size_t count - number of words
+*
+* Output: unsigned int - number of packets used
+*
+********************************************************************/
+static unsigned int TEST_RoundTrip(const uint16_t* words, size_t count)
+{
+    uint8_t packet[BOOT_RLE_PACKET_SIZE];
+    uint32_t address;
+    uint32_t packetAddress;
+    size_t position;
+    size_t carried;
+    size_t words1;
+    size_t i;
+    unsigned int packets;
+
+    address = TEST_START_ADDRESS;
+    position = 0;
+    packets = 0;
+    memset(programmed, 0, sizeof(programmed));
+    BufferedDataIndex = 0;
+    ProgrammedPointer = (unsigned int)INVALID_ADDRESS;
+
+    while(position < count)
+    {
+        carried = BOOT_RleBuildPacket(packet, address, &words[position], count - position);
+        TEST_CHECK(carried != 0);
+        if(carried == 0)
+        {
+            break;
+        }
+
+        TEST_CHECK(packet[0] == BOOT_RLE_COMMAND);
+        packetAddress = packet[1] | ((uint32_t)packet[2] << 8) | ((uint32_t)packet[3] << 16) | ((uint32_t)packet[4] << 24);
+        TEST_CHECK(packetAddress == (TEST_START_ADDRESS + (2 * position)));
+        TEST_CHECK(packet[5] <= BOOT_RLE_DATA_SIZE);
+
+        words1 = BOOT_RleDecode(&packet[BOOT_RLE_PACKET_SIZE - packet[5]], packet[5], &decoded[position], TEST_MAX_WORDS - position);
+        TEST_CHECK(words1 == carried);
+
+        TEST_ProgramRlePacket(packet);
+        TEST_CHECK(ProgrammedPointer == (TEST_START_ADDRESS + (2 * (position + carried))));
+
+        position += carried;
+        address += 2 * carried;
+        packets++;
+    }
+    TEST_ProgramComplete();
+
+    for(i = 0; i < count; i++)
+    {
+        TEST_CHECK(decoded[i] == words[i]);
+        TEST_CHECK(programmed[i] == (words[i] & 0x3FFF));
+    }
+    return packets;
+}
+
+/*********************************************************************
+* Function: void TEST_RunsAcrossPackets(void);
+*
+* Overview: A run longer than one token and a literal longer than one
+*           packet, both of which have to be split across packets.
+*
+* PreCondition: none
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+static void TEST_RunsAcrossPackets(void)
+{
+    size_t count;
+    size_t i;
+
+    count = 0;
+    for(i = 0; i < 20; i++)                 //literal that fills most of a packet
+    {
+        image[count++] = (uint16_t)(0x3000 + i);
+    }
+    for(i = 0; i < 300; i++)                //run of more than two tokens
+    {
+        image[count++] = 0x2A55;
+    }
+    for(i = 0; i < 100; i++)                //literal of more than three packets
+    {
+        image[count++] = (uint16_t)((i * 37) & 0x3FFF);
+    }
+    for(i = 0; i < 2; i++)                  //short run, cheaper as a literal
+    {
+        image[count++] = 0x0123;
+    }
+    image[count++] = 0x0124;
+
+    TEST_CHECK(TEST_RoundTrip(image, count) >= 5);
+}
+
+/*********************************************************************
+* Function: void TEST_ErasedRows(void);
+*
+* Overview: A row left erased in the .hex image (0xFFFF words) and a row
+*           holding 0x3FFF words both go out as a single run token and are
+*           programmed as 0x3FFF.
+*
+* PreCondition: none
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+static void TEST_ErasedRows(void)
+{
+    uint8_t packet[BOOT_RLE_PACKET_SIZE];
+    size_t i;
+
+    for(i = 0; i < TEST_ROW_WORDS; i++)
+    {
+        image[i] = 0xFFFF;
+        image[TEST_ROW_WORDS + i] = 0x3FFF;
+    }
+
+    TEST_CHECK(BOOT_RleBuildPacket(packet, 0x1200, image, TEST_ROW_WORDS) == TEST_ROW_WORDS);
+    TEST_CHECK(packet[5] == 3);
+    TEST_CHECK(BOOT_RleBuildPacket(packet, 0x1200, &image[TEST_ROW_WORDS], TEST_ROW_WORDS) == TEST_ROW_WORDS);
+    TEST_CHECK(packet[5] == 3);
+
+    TEST_CHECK(TEST_RoundTrip(image, 2 * TEST_ROW_WORDS) == 1);
+    for(i = 0; i < (2 * TEST_ROW_WORDS); i++)
+    {
+        TEST_CHECK(programmed[i] == 0x3FFF);
+    }
+}
+
+/*********************************************************************
+* Function: void TEST_CutToken(void);
+*
+* Overview: A token cut short by the end of the data is dropped by both
+*           decoders, the words before it are kept.
+*
+* PreCondition: none
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+static void TEST_CutToken(void)
+{
+    uint8_t packet[BOOT_RLE_PACKET_SIZE];
+    const uint8_t tokens[] = {0x01, 0x11, 0x00, 0x22, 0x00, 0x85, 0x33};
+
+    memset(packet, 0, sizeof(packet));
+    packet[0] = BOOT_RLE_COMMAND;
+    packet[5] = sizeof(tokens);
+    memcpy(&packet[BOOT_RLE_PACKET_SIZE - sizeof(tokens)], tokens, sizeof(tokens));
+
+    TEST_CHECK(BOOT_RleDecode(tokens, sizeof(tokens), decoded, TEST_MAX_WORDS) == 2);
+    TEST_CHECK((decoded[0] == 0x0011) && (decoded[1] == 0x0022));
+
+    memset(programmed, 0, sizeof(programmed));
+    BufferedDataIndex = 0;
+    ProgrammedPointer = (unsigned int)INVALID_ADDRESS;
+    packet[1] = (uint8_t)TEST_START_ADDRESS;
+    packet[2] = (uint8_t)(TEST_START_ADDRESS >> 8);
+    TEST_ProgramRlePacket(packet);
+    TEST_CHECK(ProgrammedPointer == (TEST_START_ADDRESS + 4));
+    TEST_ProgramComplete();
+    TEST_CHECK((programmed[0] == 0x0011) && (programmed[1] == 0x0022) && (programmed[2] == 0));
+}
+
+/*********************************************************************
+* Function: void TEST_Random(void);
+*
+* Overview: Pseudo random images mixing literals, runs and erased
+*           stretches, from a fixed seed so failures repeat.
+*
+* PreCondition: none
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+static void TEST_Random(void)
+{
+    uint32_t seed;
+    size_t count;
+    size_t length;
+    uint16_t word;
+    unsigned int pass;
+
+    seed = 12345;
+    for(pass = 0; pass < 200; pass++)
+    {
+        count = 0;
+        while(count < (TEST_MAX_WORDS - 300))
+        {
+            seed = (seed * 1103515245) + 12345;
+            length = 1 + ((seed >> 16) % 200);
+            seed = (seed * 1103515245) + 12345;
+            word = (uint16_t)((seed >> 8) & 0x3FFF);
+            switch((seed >> 24) & 0x03)
+            {
+                case 0:     //erased
+                    word = 0xFFFF;
+                    //fall through
+                case 1:     //run
+                    while((length-- != 0) && (count < TEST_MAX_WORDS))
+                    {
+                        image[count++] = word;
+                    }
+                    break;
+                default:    //literal, with the odd short repeat
+                    while((length-- != 0) && (count < TEST_MAX_WORDS))
+                    {
+                        seed = (seed * 1103515245) + 12345;
+                        if(((seed >> 20) & 0x07) != 0)
+                        {
+                            word = (uint16_t)((seed >> 8) & 0x3FFF);
+                        }
+                        image[count++] = word;
+                    }
+                    break;
+            }
+        }
+        TEST_RoundTrip(image, count);
+    }
+}
+
+int main(void)
+{
+    TEST_RunsAcrossPackets();
+    TEST_ErasedRows();
+    TEST_CutToken();
+    TEST_Random();
+
+    return TEST_Result("test_boot_rle");
+}
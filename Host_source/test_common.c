@@ -0,0 +1,84 @@
+/*******************************************************************************
+
+    Author:  Gaurav Singh
+    website: www.circuitvalley.com 
+    Created on October 28, 2017
+    
+    This file is part of Circuitvalley USB HID Bootloader.
+
+    Circuitvalley USB HID Bootloader is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Circuitvalley USB HID Bootloader is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Circuitvalley USB HID Bootloader.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "test_common.h"
+
+/** VARIABLES ******************************************************/
+static unsigned int failures;
+
+/*********************************************************************
+* Function: void TEST_Check(bool condition, const char* text, int line);
+*
+* Overview: Reports a failed check and counts it.  Only the first 20
+*           failures are printed.
+*
+* PreCondition: none
+*
+* Input: bool condition - the result of the check
+*        const char* text - the check, as written
+*        int line - where it is
+*
+* Output: None
+*
+********************************************************************/
+void TEST_Check(bool condition, const char* text, int line)
+{
+    if(condition == false)
+    {
+        if(failures < 20)
+        {
+            fprintf(stderr, "line %d: check failed: %s\n", line, text);
+        }
+        failures++;
+    }
+}
+
+/*********************************************************************
+* Function: int TEST_Result(const char* name);
+*
+* Overview: Prints the outcome of the test program.
+*
+* PreCondition: none
+*
+* Input: const char* name - the test program
+*
+* Output: int - EXIT_SUCCESS if every check passed, else EXIT_FAILURE,
+*               to be returned from main()
+*
+********************************************************************/
+int TEST_Result(const char* name)
+{
+    if(failures != 0)
+    {
+        printf("%s: %u check(s) failed\n", name, failures);
+        return EXIT_FAILURE;
+    }
+    printf("%s: all checks passed\n", name);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,68 @@
+/*******************************************************************************
+
+    Author:  Gaurav Singh
+    website: www.circuitvalley.com 
+    Created on October 28, 2017
+    
+    This file is part of Circuitvalley USB HID Bootloader.
+
+    Circuitvalley USB HID Bootloader is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Circuitvalley USB HID Bootloader is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Circuitvalley USB HID Bootloader.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+
+
+#ifndef TEST_COMMON_H
+#define TEST_COMMON_H
+
+#include <stdbool.h>
+
+/*** Host Test Checks **************************************************/
+//Shared by the test_*.c programs in this directory.  TEST_CHECK() reports a
+//failed condition with its line and counts it, TEST_Result() ends the run.
+#define TEST_CHECK(condition)   TEST_Check((condition), #condition, __LINE__)
+
+/*********************************************************************
+* Function: void TEST_Check(bool condition, const char* text, int line);
+*
+* Overview: Reports a failed check and counts it.  Only the first 20
+*           failures are printed.
+*
+* PreCondition: none
+*
+* Input: bool condition - the result of the check
+*        const char* text - the check, as written
+*        int line - where it is
+*
+* Output: None
+*
+********************************************************************/
+void TEST_Check(bool condition, const char* text, int line);
+
+/*********************************************************************
+* Function: int TEST_Result(const char* name);
+*
+* Overview: Prints the outcome of the test program.
+*
+* PreCondition: none
+*
+* Input: const char* name - the test program
+*
+* Output: int - EXIT_SUCCESS if every check passed, else EXIT_FAILURE,
+*               to be returned from main()
+*
+********************************************************************/
+int TEST_Result(const char* name);
+
+#endif //TEST_COMMON_H
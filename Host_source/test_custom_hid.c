@@ -0,0 +1,968 @@
+/*******************************************************************************
+
+    Author:  Gaurav Singh
+    website: www.circuitvalley.com
+    Created on October 28, 2017
+
+    This file is part of Circuitvalley USB HID Bootloader.
+
+    Circuitvalley USB HID Bootloader is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Circuitvalley USB HID Bootloader is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Circuitvalley USB HID Bootloader.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+
+
+/*** Custom HID Command Test *******************************************/
+//Runs Firmware_source/app_device_custom_hid.c with the real USB device
+//stack (usb_device.c, usb_device_hid.c, usb_descriptors.c, usb_events.c)
+//on the host.  sim/sim_usb.c models the SIE and the buffer descriptor
+//table under the stack and plays the host: every test enumerates the
+//device, sends command reports with SIM_UsbHostOut(), runs
+//APP_DeviceCustomHIDTasks() like the main loop does, and reads the replies
+//with SIM_UsbHostIn().  The data toggle and the even/odd descriptor of
+//every packet are the ones the stack armed, a wrong one fails the check
+//on the handshake.
+//
+//sim/sim_xc.c runs Timer2 and the ADC from the instruction cycles the
+//firmware spends polling, so the conversions that wait for TMR2IF and ADIF
+//(COMMAND_READ_ADC_WITH_PWM_SYNC, the synchronized sweep,
+//BATCH_OP_READ_ADC_SYNC and the stream) complete, and simAdcConversion
+//tells how each one was started.  The ADC result itself is whatever the test left in
+//ADRESH:ADRESL.  adc.c, pwm.c and sample_pack.c are the real ones, the
+//EUSART, the scheduler, SYSTEM_Initialize() and the warm reset request are
+//stubbed below, so the test sees what the application asks of them.
+//
+//Build and run from the repository root:
+//  make -C Host_source test
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <xc.h>
+#include "sim_usb.h"
+#include "system.h"
+#include "pwm.h"
+#include "app_device_custom_hid.h"
+#include "adc.h"
+#include "usart.h"
+#include "scheduler.h"
+#include "boot_request.h"
+#include "sample_pack.h"
+
+//sample_decode.h mirrors the same layout under the same names
+#undef SAMPLE_PACK_HEADER_SIZE
+#undef SAMPLE_PACK_GROUP_SAMPLES
+#undef SAMPLE_PACK_GROUP_SIZE
+#undef SAMPLE_PACK_GROUPS_PER_REPORT
+#undef SAMPLE_PACK_SAMPLES_PER_REPORT
+#include "sample_decode.h"
+#include "test_common.h"
+
+#define TEST_BATCH_TAG(operation, length)   (((operation) << 4) | (length))
+
+#define TEST_REPORT_SIZE    64
+#define TEST_UART_BUFFER    64
+
+/** VARIABLES ******************************************************/
+
+//stub state, set by the tests and by the stubs below
+static uint16_t milliseconds;
+static unsigned int bootloaderEntries;
+static uint32_t uartBaudRate;
+static unsigned int uartInitializations;
+static uint8_t uartTxFree;
+static uint8_t uartTx[TEST_UART_BUFFER];
+static uint8_t uartTxCount;
+static uint8_t uartRx[TEST_UART_BUFFER];
+static uint8_t uartRxCount;
+static USART_STATISTICS uartStatistics;
+static bool uartStatisticsCleared;
+static SYSTEM_STATE systemState;
+
+/** PRIVATE PROTOTYPES *********************************************/
+static void TEST_Start(void);
+static SIM_USB_HANDSHAKE TEST_Send(const uint8_t* command, uint8_t length);
+static SIM_USB_HANDSHAKE TEST_Receive(uint8_t* reply);
+static void TEST_SetResult(uint16_t result);
+static void TEST_NotConfigured(void);
+static void TEST_ReadAdcWithPwm(void);
+static void TEST_ReadAdcSynchronized(void);
+static void TEST_Scan(void);
+static void TEST_Batch(void);
+static void TEST_PingPong(void);
+static void TEST_UsbProfile(void);
+static void TEST_EnterBootloader(void);
+static void TEST_Uart(void);
+static void TEST_Stream(void);
+static void TEST_Sweep(void);
+
+/*********************************************************************
+* Function: void TEST_Start(void);
+*
+* Overview: Clears the stubs, sets up the peripherals like
+*           SYSTEM_Initialize(SYSTEM_STATE_USB_START), starts the USB stack
+*           like main() and enumerates the device, which runs
+*           APP_DeviceCustomHIDInitialize() from EVENT_CONFIGURED.
+*
+* PreCondition: none
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+static void TEST_Start(void)
+{
+    milliseconds = 0;
+    bootloaderEntries = 0;
+    uartBaudRate = 0;
+    uartInitializations = 0;
+    uartTxFree = TEST_UART_BUFFER;
+    uartTxCount = 0;
+    uartRxCount = 0;
+    memset(&uartStatistics, 0, sizeof(uartStatistics));
+    uartStatisticsCleared = false;
+    systemState = SYSTEM_STATE_USB_START;
+
+    ADC_SetConfiguration(ADC_CONFIGURATION_DEFAULT);
+    PWM_SetConfiguration(PWM_CONFIGURATION_DEFAULT);
+    PWM_Enable(PWM_CHANNEL_1);
+    ADC_Enable(ADC_CHANNEL_INPUT);
+    TEST_SetResult(0);
+
+    USBDeviceInit();
+    USBDeviceAttach();
+    TEST_CHECK(SIM_UsbEnumerate() == true);
+}
+
+/*********************************************************************
+* Function: SIM_USB_HANDSHAKE TEST_Send(const uint8_t* command, uint8_t length);
+*
+* Overview: Sends a command report, zero filled to 64 bytes, to the HID
+*           OUT endpoint.
+*
+* PreCondition: TEST_Start() was called
+*
+* Input: const uint8_t* command - the first bytes of the report
+*        uint8_t length - number of bytes in command
+*
+* Output: SIM_USB_HANDSHAKE - SIM_USB_ACK if the device took the report
+*
+********************************************************************/
+static SIM_USB_HANDSHAKE TEST_Send(const uint8_t* command, uint8_t length)
+{
+    uint8_t report[TEST_REPORT_SIZE];
+
+    memset(report, 0, sizeof(report));
+    memcpy(report, command, length);
+
+    return SIM_UsbHostOut(CUSTOM_DEVICE_HID_EP, report, sizeof(report));
+}
+
+/*********************************************************************
+* Function: SIM_USB_HANDSHAKE TEST_Receive(uint8_t* reply);
+*
+* Overview: Reads the next report from the HID IN endpoint and checks
+*           that it is a full 64 byte one.
+*
+* PreCondition: TEST_Start() was called
+*
+* Input: uint8_t* reply - receives the report
+*
+* Output: SIM_USB_HANDSHAKE - SIM_USB_ACK if a report was read
+*
+********************************************************************/
+static SIM_USB_HANDSHAKE TEST_Receive(uint8_t* reply)
+{
+    uint8_t length;
+    SIM_USB_HANDSHAKE handshake;
+
+    handshake = SIM_UsbHostIn(CUSTOM_DEVICE_HID_EP, reply, &length);
+    if(handshake == SIM_USB_ACK)
+    {
+        TEST_CHECK(length == TEST_REPORT_SIZE);
+    }
+    return handshake;
+}
+
+/*********************************************************************
+* Function: void TEST_SetResult(uint16_t result);
+*
+* Overview: Sets the result the next blocking conversion returns.
+*
+* PreCondition: none
+*
+* Input: uint16_t result - right adjusted 10-bit result
+*
+* Output: None
+*
+********************************************************************/
+static void TEST_SetResult(uint16_t result)
+{
+    ADRESH = (uint8_t)(result >> 8);
+    ADRESL = (uint8_t)result;
+}
+
+/*********************************************************************
+* Function: void TEST_NotConfigured(void);
+*
+* Overview: The HID endpoint does not answer before SET_CONFIGURATION,
+*           and a command taken in just before a suspend waits for the
+*           resume.
+*
+* PreCondition: none
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+static void TEST_NotConfigured(void)
+{
+    static const uint8_t command[] = {COMMAND_READ_ADC_WITH_PWM, 0x00, 0x00};
+    uint8_t reply[TEST_REPORT_SIZE];
+
+    TEST_Start();
+
+    //a bus reset drops the configuration until the host enumerates again
+    SIM_UsbBusReset();
+    TEST_CHECK(USBGetDeviceState() == DEFAULT_STATE);
+    TEST_CHECK(TEST_Send(command, sizeof(command)) == SIM_USB_TIMEOUT);
+    APP_DeviceCustomHIDTasks();
+    TEST_CHECK(TEST_Receive(reply) == SIM_USB_TIMEOUT);
+    TEST_CHECK(SIM_UsbEnumerate() == true);
+
+    TEST_CHECK(TEST_Send(command, sizeof(command)) == SIM_USB_ACK);
+    SIM_UsbSuspend();
+    TEST_CHECK(USBIsDeviceSuspended() == true);
+    TEST_CHECK(systemState == SYSTEM_STATE_USB_SUSPEND);
+    APP_DeviceCustomHIDTasks();
+    TEST_CHECK(TEST_Receive(reply) == SIM_USB_NAK);
+
+    SIM_UsbResume();
+    TEST_CHECK(USBIsDeviceSuspended() == false);
+    TEST_CHECK(systemState == SYSTEM_STATE_USB_RESUME);
+    APP_DeviceCustomHIDTasks();
+    TEST_CHECK(TEST_Receive(reply) == SIM_USB_ACK);
+    TEST_CHECK(reply[0] == COMMAND_READ_ADC_WITH_PWM);
+}
+
+/*********************************************************************
+* Function: void TEST_ReadAdcWithPwm(void);
+*
+* Overview: COMMAND_READ_ADC_WITH_PWM sets the duty cycle, converts the
+*           input channel and replies with the result.
+*
+* PreCondition: none
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+static void TEST_ReadAdcWithPwm(void)
+{
+    static const uint8_t command[] = {COMMAND_READ_ADC_WITH_PWM, 0xA5, 0x02};
+    uint8_t reply[TEST_REPORT_SIZE];
+
+    TEST_Start();
+    TEST_SetResult(0x321);
+    TEST_CHECK(TEST_Send(command, sizeof(command)) == SIM_USB_ACK);
+    APP_DeviceCustomHIDTasks();
+
+    TEST_CHECK(PWM1DCH == (uint8_t)(0x2A5 >> 2));
+    TEST_CHECK(PWM1DCL == (uint8_t)(0x2A5 << 6));
+    TEST_CHECK(ADCON0bits.CHS == ADC_CHANNEL_INPUT);
+    TEST_CHECK(TEST_Receive(reply) == SIM_USB_ACK);
+    TEST_CHECK(reply[0] == COMMAND_READ_ADC_WITH_PWM);
+    TEST_CHECK(reply[1] == 0x21);
+    TEST_CHECK(reply[2] == 0x03);
+}
+
+/*********************************************************************
+* Function: void TEST_ReadAdcSynchronized(void);
+*
+* Overview: COMMAND_READ_ADC_WITH_PWM_SYNC converts on the Timer2 match
+*           trigger once the new duty cycle has been in effect for the
+*           settle periods, and replies with the result.
+*
+* PreCondition: none
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+static void TEST_ReadAdcSynchronized(void)
+{
+    static const uint8_t settle[] = {COMMAND_READ_ADC_WITH_PWM_SYNC, 0x00, 0x02, 3};
+    static const uint8_t boundary[] = {COMMAND_READ_ADC_WITH_PWM_SYNC, 0x55, 0x01, 0};
+    uint8_t reply[TEST_REPORT_SIZE];
+
+    TEST_Start();
+    TEST_SetResult(0x1A2);
+    TEST_CHECK(TEST_Send(settle, sizeof(settle)) == SIM_USB_ACK);
+    APP_DeviceCustomHIDTasks();
+
+    TEST_CHECK(simAdcConversion.timer2Triggered == true);
+    TEST_CHECK(simAdcConversion.pwm == 0x200);
+    TEST_CHECK(simAdcConversion.pwmPeriods == 3);
+    TEST_CHECK(ADCON2 == 0);    //auto-conversion trigger off again
+    TEST_CHECK(TEST_Receive(reply) == SIM_USB_ACK);
+    TEST_CHECK(reply[0] == COMMAND_READ_ADC_WITH_PWM_SYNC);
+    TEST_CHECK((reply[1] == 0xA2) && (reply[2] == 0x01));
+
+    //0 settle periods converts at the boundary the duty cycle takes effect
+    TEST_CHECK(TEST_Send(boundary, sizeof(boundary)) == SIM_USB_ACK);
+    APP_DeviceCustomHIDTasks();
+    TEST_CHECK(simAdcConversion.timer2Triggered == true);
+    TEST_CHECK(simAdcConversion.pwm == 0x155);
+    TEST_CHECK(simAdcConversion.pwmPeriods == 0);
+    TEST_CHECK(TEST_Receive(reply) == SIM_USB_ACK);
+    TEST_CHECK(reply[0] == COMMAND_READ_ADC_WITH_PWM_SYNC);
+}
+
+/*********************************************************************
+* Function: void TEST_Scan(void);
+*
+* Overview: COMMAND_SCAN_CONFIGURE accepts a valid list and keeps it
+*           when a later one is refused, COMMAND_SCAN_READ converts it
+*           in order.
+*
+* PreCondition: none
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+static void TEST_Scan(void)
+{
+    static const uint8_t list[] = {COMMAND_SCAN_CONFIGURE, 2, ADC_CHANNEL_10, ADC_CHANNEL_TEMPERATURE};
+    static const uint8_t badChannel[] = {COMMAND_SCAN_CONFIGURE, 2, ADC_CHANNEL_10, 0x05};
+    static const uint8_t tooLong[] = {COMMAND_SCAN_CONFIGURE, ADC_SCAN_MAX_CHANNELS + 1, ADC_CHANNEL_10};
+    static const uint8_t read[] = {COMMAND_SCAN_READ};
+    uint8_t reply[TEST_REPORT_SIZE];
+
+    TEST_Start();
+
+    TEST_CHECK(TEST_Send(list, sizeof(list)) == SIM_USB_ACK);
+    APP_DeviceCustomHIDTasks();
+    TEST_CHECK(TEST_Receive(reply) == SIM_USB_ACK);
+    TEST_CHECK((reply[0] == COMMAND_SCAN_CONFIGURE) && (reply[1] == 1));
+
+    TEST_CHECK(TEST_Send(badChannel, sizeof(badChannel)) == SIM_USB_ACK);
+    APP_DeviceCustomHIDTasks();
+    TEST_CHECK(TEST_Receive(reply) == SIM_USB_ACK);
+    TEST_CHECK((reply[0] == COMMAND_SCAN_CONFIGURE) && (reply[1] == 0));
+
+    TEST_CHECK(TEST_Send(tooLong, sizeof(tooLong)) == SIM_USB_ACK);
+    APP_DeviceCustomHIDTasks();
+    TEST_CHECK(TEST_Receive(reply) == SIM_USB_ACK);
+    TEST_CHECK((reply[0] == COMMAND_SCAN_CONFIGURE) && (reply[1] == 0));
+
+    TEST_SetResult(0x1C7);
+    TEST_CHECK(TEST_Send(read, sizeof(read)) == SIM_USB_ACK);
+    APP_DeviceCustomHIDTasks();
+    TEST_CHECK(TEST_Receive(reply) == SIM_USB_ACK);
+    TEST_CHECK((reply[0] == COMMAND_SCAN_READ) && (reply[1] == 2));
+    TEST_CHECK((reply[2] == 0xC7) && (reply[3] == 0x01));
+    TEST_CHECK((reply[4] == 0xC7) && (reply[5] == 0x01));
+    TEST_CHECK((reply[6] == 0) && (reply[7] == 0));
+    //the mux is left on the last channel of the first list
+    TEST_CHECK(ADCON0bits.CHS == ADC_CHANNEL_TEMPERATURE);
+}
+
+/*********************************************************************
+* Function: void TEST_Batch(void);
+*
+* Overview: COMMAND_BATCH runs its operations in order, stops at an
+*           unknown one, one running past the report or once the reply
+*           is full, and replies with the count, the status and the
+*           results.
+*
+* PreCondition: none
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+static void TEST_Batch(void)
+{
+    static const uint8_t batch[] =
+    {
+        COMMAND_BATCH,
+        TEST_BATCH_TAG(BATCH_OP_SET_PWM, 2), 0x00, 0x01,
+        TEST_BATCH_TAG(BATCH_OP_READ_ADC, 0),
+        TEST_BATCH_TAG(BATCH_OP_READ_ADC, 1), ADC_CHANNEL_10,
+        TEST_BATCH_TAG(BATCH_OP_READ_ADC_WITH_PWM, 2), 0xFF, 0x03,
+        TEST_BATCH_TAG(0xF, 0),
+        TEST_BATCH_TAG(BATCH_OP_READ_ADC, 0),
+    };
+    static const uint8_t syncRead[] = {COMMAND_BATCH, TEST_BATCH_TAG(BATCH_OP_READ_ADC_SYNC, 3), 0xC0, 0x03, 2};
+    static const uint8_t syncThenRead[] =
+    {
+        COMMAND_BATCH,
+        TEST_BATCH_TAG(BATCH_OP_READ_ADC_SYNC, 3), 0x40, 0x01, 0,
+        TEST_BATCH_TAG(BATCH_OP_READ_ADC, 1), ADC_CHANNEL_10,
+    };
+    uint8_t operations[TEST_REPORT_SIZE];
+    uint8_t reply[TEST_REPORT_SIZE];
+    unsigned int i;
+
+    TEST_Start();
+    TEST_SetResult(0x2B4);
+    TEST_CHECK(TEST_Send(batch, sizeof(batch)) == SIM_USB_ACK);
+    APP_DeviceCustomHIDTasks();
+
+    TEST_CHECK(TEST_Receive(reply) == SIM_USB_ACK);
+    TEST_CHECK(reply[0] == COMMAND_BATCH);
+    TEST_CHECK(reply[1] == 4);
+    TEST_CHECK(reply[2] == BATCH_STATUS_BAD_OPERATION);
+    TEST_CHECK((reply[3] == 0xB4) && (reply[4] == 0x02));
+    TEST_CHECK((reply[5] == 0xB4) && (reply[6] == 0x02));
+    TEST_CHECK((reply[7] == 0xB4) && (reply[8] == 0x02));
+    TEST_CHECK((reply[9] == 0) && (reply[10] == 0));
+    TEST_CHECK(PWM1DCH == (uint8_t)(0x3FF >> 2));
+    TEST_CHECK(ADCON0bits.CHS == ADC_CHANNEL_INPUT);
+
+    //results until the reply is full
+    memset(operations, TEST_BATCH_TAG(BATCH_OP_READ_ADC, 0), sizeof(operations));
+    operations[0] = COMMAND_BATCH;
+    TEST_CHECK(TEST_Send(operations, sizeof(operations)) == SIM_USB_ACK);
+    APP_DeviceCustomHIDTasks();
+
+    TEST_CHECK(TEST_Receive(reply) == SIM_USB_ACK);
+    TEST_CHECK(reply[0] == COMMAND_BATCH);
+    TEST_CHECK(reply[1] == (TEST_REPORT_SIZE - 3) / 2);
+    TEST_CHECK(reply[2] == BATCH_STATUS_REPLY_FULL);
+
+    //one read, then 20 SET_PWM operations from [2] to [61], the one
+    //starting at [62] needs two bytes more than the report has
+    memset(operations, 0, sizeof(operations));
+    operations[0] = COMMAND_BATCH;
+    operations[1] = TEST_BATCH_TAG(BATCH_OP_READ_ADC, 0);
+    for(i = 2; i < TEST_REPORT_SIZE; i += 3)
+    {
+        operations[i] = TEST_BATCH_TAG(BATCH_OP_SET_PWM, 2);
+    }
+    TEST_CHECK(TEST_Send(operations, sizeof(operations)) == SIM_USB_ACK);
+    APP_DeviceCustomHIDTasks();
+
+    TEST_CHECK(TEST_Receive(reply) == SIM_USB_ACK);
+    TEST_CHECK(reply[0] == COMMAND_BATCH);
+    TEST_CHECK(reply[1] == 1 + 20);
+    TEST_CHECK(reply[2] == BATCH_STATUS_TRUNCATED);
+    TEST_CHECK((reply[3] == 0xB4) && (reply[4] == 0x02));
+    TEST_CHECK(PWM1DCH == 0);
+
+    //a synchronized read converts on the Timer2 trigger, a plain read after
+    //it does not
+    TEST_CHECK(TEST_Send(syncRead, sizeof(syncRead)) == SIM_USB_ACK);
+    APP_DeviceCustomHIDTasks();
+
+    TEST_CHECK(TEST_Receive(reply) == SIM_USB_ACK);
+    TEST_CHECK(reply[0] == COMMAND_BATCH);
+    TEST_CHECK(reply[1] == 1);
+    TEST_CHECK(reply[2] == BATCH_STATUS_OK);
+    TEST_CHECK((reply[3] == 0xB4) && (reply[4] == 0x02));
+    TEST_CHECK(simAdcConversion.timer2Triggered == true);
+    TEST_CHECK(simAdcConversion.pwm == 0x3C0);
+    TEST_CHECK(simAdcConversion.pwmPeriods == 2);
+
+    TEST_CHECK(TEST_Send(syncThenRead, sizeof(syncThenRead)) == SIM_USB_ACK);
+    APP_DeviceCustomHIDTasks();
+
+    TEST_CHECK(TEST_Receive(reply) == SIM_USB_ACK);
+    TEST_CHECK((reply[1] == 2) && (reply[2] == BATCH_STATUS_OK));
+    TEST_CHECK(simAdcConversion.timer2Triggered == false);
+    TEST_CHECK(PWM1DCH == (uint8_t)(0x140 >> 2));
+}
+
+/*********************************************************************
+* Function: void TEST_PingPong(void);
+*
+* Overview: The host can queue two commands while both IN buffers hold
+*           unread replies, a third one is NAKed, and the replies come
+*           back in order as the host reads them.
+*
+* PreCondition: none
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+static void TEST_PingPong(void)
+{
+    static const uint8_t command[] = {COMMAND_READ_ADC_WITH_PWM, 0x00, 0x00};
+    uint8_t reply[TEST_REPORT_SIZE];
+    uint16_t expected;
+
+    TEST_Start();
+
+    //commands 1 and 2 take both IN buffers
+    TEST_CHECK(TEST_Send(command, sizeof(command)) == SIM_USB_ACK);
+    TEST_CHECK(TEST_Send(command, sizeof(command)) == SIM_USB_ACK);
+    TEST_SetResult(1);
+    APP_DeviceCustomHIDTasks();
+    TEST_SetResult(2);
+    APP_DeviceCustomHIDTasks();
+
+    //commands 3 and 4 wait in the OUT buffers, 5 is NAKed
+    TEST_CHECK(TEST_Send(command, sizeof(command)) == SIM_USB_ACK);
+    TEST_CHECK(TEST_Send(command, sizeof(command)) == SIM_USB_ACK);
+    TEST_CHECK(TEST_Send(command, sizeof(command)) == SIM_USB_NAK);
+    TEST_SetResult(0x3FF);
+    APP_DeviceCustomHIDTasks();
+
+    //each reply read lets one more command run
+    for(expected = 1; expected <= 5; expected++)
+    {
+        TEST_CHECK(TEST_Receive(reply) == SIM_USB_ACK);
+        TEST_CHECK((reply[0] == COMMAND_READ_ADC_WITH_PWM) && (reply[1] == expected) && (reply[2] == 0));
+
+        TEST_SetResult(expected + 2);
+        APP_DeviceCustomHIDTasks();
+        if(expected == 1)
+        {
+            TEST_CHECK(TEST_Send(command, sizeof(command)) == SIM_USB_ACK);
+        }
+    }
+    TEST_CHECK(TEST_Receive(reply) == SIM_USB_NAK);
+}
+
+/*********************************************************************
+* Function: void TEST_UsbProfile(void);
+*
+* Overview: Without USB_ENABLE_CYCLE_PROFILING, COMMAND_GET_USB_PROFILE
+*           replies with an event count of 0.
+*
+* PreCondition: none
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+static void TEST_UsbProfile(void)
+{
+    static const uint8_t command[] = {COMMAND_GET_USB_PROFILE, 1, 0};
+    uint8_t reply[TEST_REPORT_SIZE];
+
+    TEST_Start();
+    TEST_CHECK(TEST_Send(command, sizeof(command)) == SIM_USB_ACK);
+    APP_DeviceCustomHIDTasks();
+
+    TEST_CHECK(TEST_Receive(reply) == SIM_USB_ACK);
+    TEST_CHECK((reply[0] == COMMAND_GET_USB_PROFILE) && (reply[1] == 0));
+}
+
+/*********************************************************************
+* Function: void TEST_EnterBootloader(void);
+*
+* Overview: COMMAND_ENTER_BOOTLOADER only enters the bootloader with the
+*           right key, and never replies.
+*
+* PreCondition: none
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+static void TEST_EnterBootloader(void)
+{
+    static const uint8_t wrongKey[] = {COMMAND_ENTER_BOOTLOADER, 0xB0, 0x07};
+    static const uint8_t key[] = {COMMAND_ENTER_BOOTLOADER, 0x07, 0xB0};
+    uint8_t reply[TEST_REPORT_SIZE];
+
+    TEST_Start();
+    TEST_CHECK(TEST_Send(wrongKey, sizeof(wrongKey)) == SIM_USB_ACK);
+    APP_DeviceCustomHIDTasks();
+    TEST_CHECK(bootloaderEntries == 0);
+
+    TEST_CHECK(TEST_Send(key, sizeof(key)) == SIM_USB_ACK);
+    APP_DeviceCustomHIDTasks();
+    TEST_CHECK(bootloaderEntries == 1);
+    TEST_CHECK(TEST_Receive(reply) == SIM_USB_NAK);
+}
+
+/*********************************************************************
+* Function: void TEST_Uart(void);
+*
+* Overview: The UART bridge commands: data dropped while the bridge is
+*           closed, opening with and without a baud rate, the status
+*           report, data held back until the TX ring has room, received
+*           bytes sent after the flush time, and nothing sent after
+*           COMMAND_UART_CLOSE.
+*
+* PreCondition: none
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+static void TEST_Uart(void)
+{
+    static const uint8_t openZero[] = {COMMAND_UART_OPEN, 0, 0, 0, 0, 0};
+    static const uint8_t open[] = {COMMAND_UART_OPEN, 0x00, 0xC2, 0x01, 0x00, 5};
+    static const uint8_t status[] = {COMMAND_UART_STATUS, 1};
+    static const uint8_t data[] = {COMMAND_UART_DATA, 5, 'h', 'e', 'l', 'l', 'o'};
+    static const uint8_t overLong[] = {COMMAND_UART_DATA, TEST_REPORT_SIZE};
+    static const uint8_t close[] = {COMMAND_UART_CLOSE};
+    uint8_t reply[TEST_REPORT_SIZE];
+
+    TEST_Start();
+
+    //data for a closed bridge is dropped even when the TX ring is full, so
+    //it can't wedge the OUT endpoint
+    uartTxFree = 0;
+    TEST_CHECK(TEST_Send(data, sizeof(data)) == SIM_USB_ACK);
+    APP_DeviceCustomHIDTasks();
+    TEST_CHECK(uartTxCount == 0);
+    uartTxFree = TEST_UART_BUFFER;
+
+    TEST_CHECK(TEST_Send(openZero, sizeof(openZero)) == SIM_USB_ACK);
+    APP_DeviceCustomHIDTasks();
+    TEST_CHECK(TEST_Receive(reply) == SIM_USB_ACK);
+    TEST_CHECK((reply[0] == COMMAND_UART_OPEN) && (reply[1] == 0));
+    TEST_CHECK(uartInitializations == 0);
+
+    TEST_CHECK(TEST_Send(open, sizeof(open)) == SIM_USB_ACK);
+    APP_DeviceCustomHIDTasks();
+    TEST_CHECK(TEST_Receive(reply) == SIM_USB_ACK);
+    TEST_CHECK((reply[0] == COMMAND_UART_OPEN) && (reply[1] == 1));
+    TEST_CHECK((uartBaudRate == 115200) && (uartInitializations == 1));
+
+    uartStatistics.rxBufferOverruns = 0x1234;
+    uartStatistics.rxHardwareOverruns = 0x0056;
+    uartStatistics.rxFramingErrors = 0x0789;
+    uartTxFree = 40;
+    TEST_CHECK(TEST_Send(status, sizeof(status)) == SIM_USB_ACK);
+    APP_DeviceCustomHIDTasks();
+    TEST_CHECK(TEST_Receive(reply) == SIM_USB_ACK);
+    TEST_CHECK(reply[0] == COMMAND_UART_STATUS);
+    TEST_CHECK((reply[1] == 0x34) && (reply[2] == 0x12));
+    TEST_CHECK((reply[3] == 0x56) && (reply[4] == 0x00));
+    TEST_CHECK((reply[5] == 0x89) && (reply[6] == 0x07));
+    TEST_CHECK((reply[7] == 0) && (reply[8] == 40));
+    TEST_CHECK(uartStatisticsCleared == true);
+
+    //held back while the TX ring has room for 4 of the 5 bytes
+    uartTxFree = 4;
+    TEST_CHECK(TEST_Send(data, sizeof(data)) == SIM_USB_ACK);
+    APP_DeviceCustomHIDTasks();
+    TEST_CHECK(uartTxCount == 0);
+    uartTxFree = 5;
+    APP_DeviceCustomHIDTasks();
+    TEST_CHECK((uartTxCount == 5) && (memcmp(uartTx, "hello", 5) == 0));
+
+    //a report claiming more than a payload is dropped, not held back
+    uartTxFree = 0;
+    TEST_CHECK(TEST_Send(overLong, sizeof(overLong)) == SIM_USB_ACK);
+    TEST_CHECK(TEST_Send(overLong, sizeof(overLong)) == SIM_USB_ACK);
+    APP_DeviceCustomHIDTasks();
+    APP_DeviceCustomHIDTasks();
+    TEST_CHECK(uartTxCount == 5);
+    TEST_CHECK(TEST_Send(overLong, sizeof(overLong)) == SIM_USB_ACK);
+
+    //received bytes wait the flush time of 5ms
+    memcpy(uartRx, "abc", 3);
+    uartRxCount = 3;
+    milliseconds = 100;
+    APP_DeviceCustomHIDTasks();
+    milliseconds = 104;
+    APP_DeviceCustomHIDTasks();
+    TEST_CHECK(TEST_Receive(reply) == SIM_USB_NAK);
+    milliseconds = 105;
+    APP_DeviceCustomHIDTasks();
+    TEST_CHECK(TEST_Receive(reply) == SIM_USB_ACK);
+    TEST_CHECK((reply[0] == COMMAND_UART_DATA) && (reply[1] == 3));
+    TEST_CHECK(memcmp(&reply[2], "abc", 3) == 0);
+    TEST_CHECK(uartRxCount == 0);
+
+    TEST_CHECK(TEST_Send(close, sizeof(close)) == SIM_USB_ACK);
+    APP_DeviceCustomHIDTasks();
+    uartRxCount = 1;
+    milliseconds = 200;
+    APP_DeviceCustomHIDTasks();
+    milliseconds = 300;
+    APP_DeviceCustomHIDTasks();
+    TEST_CHECK(TEST_Receive(reply) == SIM_USB_NAK);
+}
+
+/*********************************************************************
+* Function: void TEST_Stream(void);
+*
+* Overview: COMMAND_START_STREAM sends a packed report as soon as the
+*           ring holds a report worth of conversions, and
+*           COMMAND_STOP_STREAM stops the conversions.
+*
+* PreCondition: none
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+static void TEST_Stream(void)
+{
+    static const uint8_t start[] = {COMMAND_START_STREAM, 0, 0};
+    static const uint8_t stop[] = {COMMAND_STOP_STREAM};
+    uint8_t reply[TEST_REPORT_SIZE];
+    SAMPLE_REPORT decoded;
+    unsigned int i;
+
+    TEST_Start();
+    TEST_CHECK(TEST_Send(start, sizeof(start)) == SIM_USB_ACK);
+    APP_DeviceCustomHIDTasks();
+    TEST_CHECK(PIE1bits.ADIE == 1);
+    TEST_CHECK(ADCON0bits.CHS == ADC_CHANNEL_INPUT);
+
+    for(i = 0; i < SAMPLE_PACK_SAMPLES_PER_REPORT; i++)
+    {
+        APP_DeviceCustomHIDTasks();
+        TEST_CHECK(TEST_Receive(reply) == SIM_USB_NAK);
+
+        //the next Timer2 triggered conversion, handled in time
+        while(PIR1bits.ADIF == 0);
+        TEST_SetResult((uint16_t)((i * 21) & 0x3FF));
+        ADC_InterruptHandler();
+    }
+    APP_DeviceCustomHIDTasks();
+
+    TEST_CHECK(TEST_Receive(reply) == SIM_USB_ACK);
+    SAMPLE_DecodeReport(reply, &decoded);
+    TEST_CHECK(decoded.type == COMMAND_STREAM_DATA);
+    TEST_CHECK((decoded.sequence == 0) && (decoded.timestamp == 0));
+    for(i = 0; i < SAMPLE_PACK_SAMPLES_PER_REPORT; i++)
+    {
+        TEST_CHECK(decoded.samples[i] == ((i * 21) & 0x3FF));
+    }
+
+    TEST_CHECK(TEST_Send(stop, sizeof(stop)) == SIM_USB_ACK);
+    APP_DeviceCustomHIDTasks();
+    TEST_CHECK(PIE1bits.ADIE == 0);
+    TEST_CHECK(ADC_StreamAvailable() == 0);
+    TEST_CHECK(TEST_Receive(reply) == SIM_USB_NAK);
+}
+
+/*********************************************************************
+* Function: void TEST_Sweep(void);
+*
+* Overview: COMMAND_START_SWEEP sends the (pwm, adc) points in
+*           COMMAND_SWEEP_DATA reports ending with a COMMAND_SWEEP_END
+*           one, COMMAND_START_STREAM cancels a running sweep, a
+*           synchronized sweep converts on the Timer2 trigger, and a
+*           settle time above the limit of either mode is refused.
+*
+* PreCondition: none
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+static void TEST_Sweep(void)
+{
+    //0 to 0x3E0 in steps of 0x20, 32 points
+    static const uint8_t sweep[] = {COMMAND_START_SWEEP, 0x00, 0x00, 0xE0, 0x03, 0x20, 0x00, 3, 0, 0};
+    static const uint8_t longSweep[] = {COMMAND_START_SWEEP, 0x00, 0x00, 0xFF, 0x03, 0x01, 0x00, 0, 0, 0};
+    static const uint8_t start[] = {COMMAND_START_STREAM, 0, 0};
+    //settle times just above and at the limit of 1000us
+    static const uint8_t longSettle[] = {COMMAND_START_SWEEP, 0x00, 0x00, 0x10, 0x00, 0x01, 0x00, 0xE9, 0x03, 0};
+    static const uint8_t maxSettle[] = {COMMAND_START_SWEEP, 0x00, 0x00, 0x10, 0x00, 0x01, 0x00, 0xE8, 0x03, 0};
+    //0x100 to 0x180 in steps of 0x40 synchronized, settle periods above and
+    //at the limit of 47
+    static const uint8_t longSync[] = {COMMAND_START_SWEEP, 0x00, 0x01, 0x80, 0x01, 0x40, 0x00, 48, 0, SWEEP_MODE_SYNCHRONIZED};
+    static const uint8_t sync[] = {COMMAND_START_SWEEP, 0x00, 0x01, 0x80, 0x01, 0x40, 0x00, 47, 0, SWEEP_MODE_SYNCHRONIZED};
+    uint8_t reply[TEST_REPORT_SIZE];
+    SAMPLE_REPORT decoded;
+    unsigned int i;
+    unsigned int point;
+
+    TEST_Start();
+    TEST_SetResult(0x155);
+    TEST_CHECK(TEST_Send(sweep, sizeof(sweep)) == SIM_USB_ACK);
+    APP_DeviceCustomHIDTasks();
+    APP_DeviceCustomHIDTasks();
+
+    TEST_CHECK(TEST_Receive(reply) == SIM_USB_ACK);
+    SAMPLE_DecodeReport(reply, &decoded);
+    TEST_CHECK(decoded.type == COMMAND_SWEEP_DATA);
+    TEST_CHECK((decoded.sequence == 0) && (decoded.timestamp == 0));
+    for(i = 0; i < SWEEP_POINTS_PER_REPORT; i++)
+    {
+        TEST_CHECK((decoded.samples[i * 2] == i * 0x20) && (decoded.samples[(i * 2) + 1] == 0x155));
+    }
+
+    TEST_CHECK(TEST_Receive(reply) == SIM_USB_ACK);
+    SAMPLE_DecodeReport(reply, &decoded);
+    TEST_CHECK(decoded.type == COMMAND_SWEEP_END);
+    TEST_CHECK((decoded.sequence == 1) && (decoded.timestamp == SWEEP_POINTS_PER_REPORT));
+    for(i = 0; i < SWEEP_POINTS_PER_REPORT; i++)
+    {
+        point = SWEEP_POINTS_PER_REPORT + i;
+        if(point < 32)
+        {
+            TEST_CHECK((decoded.samples[i * 2] == point * 0x20) && (decoded.samples[(i * 2) + 1] == 0x155));
+        }
+        else
+        {
+            TEST_CHECK((decoded.samples[i * 2] == 0) && (decoded.samples[(i * 2) + 1] == 0));
+        }
+    }
+    TEST_CHECK(PWM1DCH == (uint8_t)(0x3E0 >> 2));
+
+    APP_DeviceCustomHIDTasks();
+    TEST_CHECK(TEST_Receive(reply) == SIM_USB_NAK);
+
+    //a stream replaces a running sweep, the report already sent stays
+    TEST_CHECK(TEST_Send(longSweep, sizeof(longSweep)) == SIM_USB_ACK);
+    APP_DeviceCustomHIDTasks();
+    TEST_CHECK(TEST_Send(start, sizeof(start)) == SIM_USB_ACK);
+    APP_DeviceCustomHIDTasks();
+    TEST_CHECK(TEST_Receive(reply) == SIM_USB_ACK);
+    TEST_CHECK(reply[0] == COMMAND_SWEEP_DATA);
+    APP_DeviceCustomHIDTasks();
+    APP_DeviceCustomHIDTasks();
+    TEST_CHECK(TEST_Receive(reply) == SIM_USB_NAK);
+    TEST_CHECK(PIE1bits.ADIE == 1);
+
+    //a settle time that would hold up the main loop is refused
+    TEST_Start();
+    TEST_CHECK(TEST_Send(longSettle, sizeof(longSettle)) == SIM_USB_ACK);
+    APP_DeviceCustomHIDTasks();
+    APP_DeviceCustomHIDTasks();
+    TEST_CHECK(TEST_Receive(reply) == SIM_USB_NAK);
+
+    TEST_CHECK(TEST_Send(maxSettle, sizeof(maxSettle)) == SIM_USB_ACK);
+    APP_DeviceCustomHIDTasks();
+    TEST_CHECK(TEST_Receive(reply) == SIM_USB_ACK);
+    TEST_CHECK(reply[0] == COMMAND_SWEEP_END);
+
+    //synchronized, the settle time in PWM periods
+    TEST_CHECK(TEST_Send(longSync, sizeof(longSync)) == SIM_USB_ACK);
+    APP_DeviceCustomHIDTasks();
+    APP_DeviceCustomHIDTasks();
+    TEST_CHECK(TEST_Receive(reply) == SIM_USB_NAK);
+
+    TEST_SetResult(0x2AA);
+    TEST_CHECK(TEST_Send(sync, sizeof(sync)) == SIM_USB_ACK);
+    APP_DeviceCustomHIDTasks();
+    TEST_CHECK(TEST_Receive(reply) == SIM_USB_ACK);
+    SAMPLE_DecodeReport(reply, &decoded);
+    TEST_CHECK(decoded.type == COMMAND_SWEEP_END);
+    for(i = 0; i < 3; i++)
+    {
+        TEST_CHECK((decoded.samples[i * 2] == 0x100 + (i * 0x40)) && (decoded.samples[(i * 2) + 1] == 0x2AA));
+    }
+    TEST_CHECK(simAdcConversion.timer2Triggered == true);
+    TEST_CHECK(simAdcConversion.pwm == 0x180);
+    TEST_CHECK(simAdcConversion.pwmPeriods == SWEEP_SETTLE_PERIODS_MAX);
+}
+
+/** STUBS **********************************************************/
+//The application calls these, the test checks what they were given.
+
+uint16_t SCHEDULER_Milliseconds(void)
+{
+    return milliseconds;
+}
+
+void BOOT_EnterBootloader(void)
+{
+    bootloaderEntries++;
+}
+
+void SYSTEM_Initialize(SYSTEM_STATE state)
+{
+    systemState = state;
+}
+
+void USART_SetBaudRate(uint32_t baudRate)
+{
+    uartBaudRate = baudRate;
+}
+
+void USART_Initialize()
+{
+    uartInitializations++;
+}
+
+uint8_t USART_TxFree(void)
+{
+    return uartTxFree;
+}
+
+uint8_t USART_RxCount(void)
+{
+    return uartRxCount;
+}
+
+uint8_t USART_WriteBuffer(const uint8_t* data, uint8_t length)
+{
+    if((uartTxCount + length) > TEST_UART_BUFFER)
+    {
+        length = TEST_UART_BUFFER - uartTxCount;
+    }
+    memcpy(&uartTx[uartTxCount], data, length);
+    uartTxCount += length;
+    return length;
+}
+
+uint8_t USART_ReadBuffer(uint8_t* data, uint8_t length)
+{
+    if(length > uartRxCount)
+    {
+        length = uartRxCount;
+    }
+    memcpy(data, uartRx, length);
+    memmove(uartRx, &uartRx[length], uartRxCount - length);
+    uartRxCount -= length;
+    return length;
+}
+
+void USART_GetStatistics(USART_STATISTICS* statistics, bool clear)
+{
+    *statistics = uartStatistics;
+    uartStatisticsCleared = clear;
+    if(clear == true)
+    {
+        memset(&uartStatistics, 0, sizeof(uartStatistics));
+    }
+}
+
+int main(void)
+{
+    TEST_NotConfigured();
+    TEST_ReadAdcWithPwm();
+    TEST_ReadAdcSynchronized();
+    TEST_Scan();
+    TEST_Batch();
+    TEST_PingPong();
+    TEST_UsbProfile();
+    TEST_EnterBootloader();
+    TEST_Uart();
+    TEST_Stream();
+    TEST_Sweep();
+
+    return TEST_Result("test_custom_hid");
+}
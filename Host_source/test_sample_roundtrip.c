@@ -0,0 +1,582 @@
+/*******************************************************************************
+
+    Author:  Gaurav Singh
+    website: www.circuitvalley.com 
+    Created on October 28, 2017
+    
+    This file is part of Circuitvalley USB HID Bootloader.
+
+    Circuitvalley USB HID Bootloader is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Circuitvalley USB HID Bootloader is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Circuitvalley USB HID Bootloader.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+
+/*** Stream Report Round-Trip Test ************************************/
+//Runs the firmware stream path on the host: conversions are fed to the real
+//ADC_InterruptHandler() (Firmware_source/adc.c), reports are built from
+//ADC_StreamRead() with Firmware_source/sample_pack.c the way
+//APP_DeviceCustomHIDStreamFill() builds them, and decoded again with
+//SAMPLE_DecodeReport().  Every conversion carries its own index (mod 1024)
+//as its value, and the test keeps the index of every conversion the ring
+//accepted, so the decoded samples and timestamps are checked against what
+//really happened.  Covered: the packing of every 10-bit value, drops
+//of exactly streamGapMax conversions (timestamps stay exact), drops of more
+//(the gap tag saturates and the timestamp falls behind by the excess),
+//conversions overwritten before a late interrupt ran, with and without
+//oversampling, and the wrap of the 8-bit sequence and the 16-bit timestamp.
+//
+//sim/sim_xc.c runs Timer1, Timer2 and the Timer2 triggered conversions
+//from the cycles the test spends polling ADIF, so the interrupt handler
+//sees the same timers it does on the board.
+//
+//Build and run from the repository root:
+//  make -C Host_source test
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <xc.h>
+#include "adc.h"
+#include "pwm.h"
+#include "sample_pack.h"
+
+//sample_decode.h mirrors the same layout under the same names
+#undef SAMPLE_PACK_HEADER_SIZE
+#undef SAMPLE_PACK_GROUP_SAMPLES
+#undef SAMPLE_PACK_GROUP_SIZE
+#undef SAMPLE_PACK_GROUPS_PER_REPORT
+#undef SAMPLE_PACK_SAMPLES_PER_REPORT
+#include "sample_decode.h"
+#include "test_common.h"
+
+#define TEST_GAP_MAX        ((1 << ADC_OVERSAMPLE_MAX) - 1)    //streamGapMax without oversampling
+#define TEST_RING_CAPACITY  (ADC_STREAM_BUFFER_SIZE - 1)
+
+/** VARIABLES ******************************************************/
+static uint32_t conversionIndex;    //index of the next conversion, never wraps
+static uint32_t stored[ADC_STREAM_BUFFER_SIZE];     //index of every sample in the ring
+static unsigned int storedHead;
+static unsigned int storedTail;
+static uint8_t sequence;
+
+/** PRIVATE PROTOTYPES *********************************************/
+static void TEST_Convert(void);
+static void TEST_Drop(unsigned int count);
+static void TEST_Miss(unsigned int count);
+static void TEST_BuildReport(uint8_t* report);
+static void TEST_Start(SAMPLE_REPORT* last);
+static uint32_t TEST_Drain(SAMPLE_REPORT* last, uint32_t lateBy, uint32_t maxReports);
+static void TEST_PackAllValues(void);
+static void TEST_GapAtMax(void);
+static void TEST_GapSaturates(void);
+static void TEST_LateInterrupt(void);
+static void TEST_LateInterruptOversampled(void);
+static void TEST_CounterWrap(void);
+
+/*********************************************************************
+* Function: void TEST_Convert(void);
+*
+* Overview: Waits for the next Timer2 triggered conversion, its result
+*           being its own index mod 1024, and runs the ADC interrupt for
+*           it.  Notes the index if the ring took the result.
+*
+* PreCondition: ADC_StreamStart() was called
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+static void TEST_Convert(void)
+{
+    uint16_t value;
+    uint8_t available;
+
+    while(PIR1bits.ADIF == 0);
+
+    value = (uint16_t)(conversionIndex & 0x3FF);
+    ADRESH = (uint8_t)(value >> 8);
+    ADRESL = (uint8_t)value;
+    available = ADC_StreamAvailable();
+    ADC_InterruptHandler();
+    if(ADC_StreamAvailable() != available)
+    {
+        stored[storedHead] = conversionIndex;
+        storedHead = (storedHead + 1) % ADC_STREAM_BUFFER_SIZE;
+    }
+    conversionIndex++;
+}
+
+/*********************************************************************
+* Function: void TEST_Drop(unsigned int count);
+*
+* Overview: Completes count conversions while the ring is full, so the
+*           interrupt drops all of them.
+*
+* PreCondition: the ring holds TEST_RING_CAPACITY samples
+*
+* Input: unsigned int count - conversions to drop
+*
+* Output: None
+*
+********************************************************************/
+static void TEST_Drop(unsigned int count)
+{
+    while(count-- != 0)
+    {
+        TEST_Convert();
+    }
+}
+
+/*********************************************************************
+* Function: void TEST_Miss(unsigned int count);
+*
+* Overview: Lets count conversions complete without running the interrupt,
+*           as if it ran late and the next conversion overwrote them.
+*
+* PreCondition: ADC_StreamStart() was called
+*
+* Input: unsigned int count - conversions to miss
+*
+* Output: None
+*
+********************************************************************/
+static void TEST_Miss(unsigned int count)
+{
+    while(count-- != 0)
+    {
+        while(PIR1bits.ADIF == 0);
+        PIR1bits.ADIF = 0;
+        conversionIndex++;
+    }
+}
+
+/*********************************************************************
+* Function: void TEST_BuildReport(uint8_t* report);
+*
+* Overview: Builds one packed report, as APP_DeviceCustomHIDStreamFill()
+*           does without oversampling.
+*
+* PreCondition: ADC_StreamAvailable() >= SAMPLE_PACK_SAMPLES_PER_REPORT
+*
+* Input: uint8_t* report - 64 bytes
+*
+* Output: None
+*
+********************************************************************/
+static void TEST_BuildReport(uint8_t* report)
+{
+    uint8_t i;
+    uint8_t index;
+    uint16_t group[SAMPLE_PACK_GROUP_SAMPLES];
+
+    memset(report, 0, SAMPLE_REPORT_SIZE);
+    index = SAMPLE_PACK_HEADER_SIZE;
+    for(i = 0; i < SAMPLE_PACK_GROUPS_PER_REPORT; i++)
+    {
+        group[0] = ADC_StreamRead();
+        if(i == 0)
+        {
+            SAMPLE_PackHeader(&report[0], SAMPLE_REPORT_STREAM_DATA, sequence++, ADC_StreamTimestamp());
+        }
+        group[1] = ADC_StreamRead();
+        group[2] = ADC_StreamRead();
+        group[3] = ADC_StreamRead();
+
+        SAMPLE_PackGroup(&report[index], group);
+        index += SAMPLE_PACK_GROUP_SIZE;
+    }
+}
+
+/*********************************************************************
+* Function: void TEST_Start(SAMPLE_REPORT* last);
+*
+* Overview: Starts the PWM and a new stream without oversampling, from
+*           conversion 0.
+*
+* PreCondition: none
+*
+* Input: SAMPLE_REPORT* last - set up as the report before the first one
+*
+* Output: None
+*
+********************************************************************/
+static void TEST_Start(SAMPLE_REPORT* last)
+{
+    ADC_SetConfiguration(ADC_CONFIGURATION_DEFAULT);
+    PWM_SetConfiguration(PWM_CONFIGURATION_DEFAULT);
+    PWM_Enable(PWM_CHANNEL_1);
+
+    TEST_CHECK(ADC_StreamStart(ADC_CHANNEL_3, 0) == true);
+    conversionIndex = 0;
+    storedHead = 0;
+    storedTail = 0;
+    sequence = 0;
+    last->sequence = 0xFF;
+}
+
+/*********************************************************************
+* Function: uint32_t TEST_Drain(SAMPLE_REPORT* last, uint32_t lateBy, uint32_t maxReports);
+*
+* Overview: Sends and decodes up to maxReports whole reports waiting in
+*           the ring.  Checks that each report follows the previous one in
+*           sequence, that every sample is the conversion the ring took,
+*           and that the timestamp is the index of the first sample less
+*           lateBy, mod 65536.
+*
+* PreCondition: last holds the previously decoded report
+*
+* Input: SAMPLE_REPORT* last - previous report in, last report out
+*        uint32_t lateBy - conversions the timestamps are known to miss
+*        uint32_t maxReports - most reports to send
+*
+* Output: uint32_t - the number of reports decoded
+*
+********************************************************************/
+static uint32_t TEST_Drain(SAMPLE_REPORT* last, uint32_t lateBy, uint32_t maxReports)
+{
+    uint8_t report[SAMPLE_REPORT_SIZE];
+    SAMPLE_REPORT decoded;
+    uint32_t reports;
+    unsigned int i;
+
+    reports = 0;
+    while((reports < maxReports) && (ADC_StreamAvailable() >= SAMPLE_PACK_SAMPLES_PER_REPORT))
+    {
+        TEST_BuildReport(report);
+        SAMPLE_DecodeReport(report, &decoded);
+
+        TEST_CHECK(decoded.type == SAMPLE_REPORT_STREAM_DATA);
+        TEST_CHECK(decoded.count == SAMPLE_PACK_SAMPLES_PER_REPORT);
+        TEST_CHECK(decoded.sequence == (uint8_t)(last->sequence + 1));
+        TEST_CHECK(decoded.timestamp == (uint16_t)(stored[storedTail] - lateBy));
+        for(i = 0; i < decoded.count; i++)
+        {
+            TEST_CHECK(decoded.samples[i] == (stored[storedTail] & 0x3FF));
+            storedTail = (storedTail + 1) % ADC_STREAM_BUFFER_SIZE;
+        }
+
+        *last = decoded;
+        reports++;
+    }
+    return reports;
+}
+
+/*********************************************************************
+* Function: void TEST_PackAllValues(void);
+*
+* Overview: Packs and decodes every 10-bit value in every group position.
+*
+* PreCondition: none
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+static void TEST_PackAllValues(void)
+{
+    uint8_t report[SAMPLE_REPORT_SIZE];
+    uint16_t group[SAMPLE_PACK_GROUP_SAMPLES];
+    SAMPLE_REPORT decoded;
+    unsigned int value;
+    unsigned int i;
+    unsigned int g;
+
+    for(value = 0; value < 1024; value++)
+    {
+        SAMPLE_PackHeader(report, SAMPLE_REPORT_STREAM_DATA, (uint8_t)value, (uint16_t)(value * 65));
+        for(g = 0; g < SAMPLE_PACK_GROUPS_PER_REPORT; g++)
+        {
+            for(i = 0; i < SAMPLE_PACK_GROUP_SAMPLES; i++)
+            {
+                group[i] = (uint16_t)((value + (g * SAMPLE_PACK_GROUP_SAMPLES) + i) & 0x3FF);
+            }
+            SAMPLE_PackGroup(&report[SAMPLE_PACK_HEADER_SIZE + (g * SAMPLE_PACK_GROUP_SIZE)], group);
+        }
+
+        SAMPLE_DecodeReport(report, &decoded);
+        TEST_CHECK(decoded.sequence == (uint8_t)value);
+        TEST_CHECK(decoded.timestamp == (uint16_t)(value * 65));
+        for(i = 0; i < SAMPLE_PACK_SAMPLES_PER_REPORT; i++)
+        {
+            TEST_CHECK(decoded.samples[i] == ((value + i) & 0x3FF));
+        }
+    }
+}
+
+/*********************************************************************
+* Function: void TEST_GapAtMax(void);
+*
+* Overview: Drops exactly streamGapMax conversions while the ring is
+*           full.  The gap tag holds the whole gap, so every timestamp
+*           stays exact and SAMPLE_DroppedBetween() finds the drop.
+*
+* PreCondition: none
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+static void TEST_GapAtMax(void)
+{
+    SAMPLE_REPORT last;
+    SAMPLE_REPORT before;
+    unsigned int i;
+
+    TEST_Start(&last);
+
+    //fill the ring with two whole reports plus the rest, then drop
+    for(i = 0; i < TEST_RING_CAPACITY; i++)
+    {
+        TEST_Convert();
+    }
+    TEST_Drop(TEST_GAP_MAX);
+    TEST_CHECK(ADC_StreamOverflowCount() == TEST_GAP_MAX);
+
+    TEST_CHECK(TEST_Drain(&last, 0, UINT32_MAX) == (TEST_RING_CAPACITY / SAMPLE_PACK_SAMPLES_PER_REPORT));
+    before = last;
+
+    //the leftover samples of the full ring, then the first one after the gap
+    for(i = 0; i < (2 * SAMPLE_PACK_SAMPLES_PER_REPORT); i++)
+    {
+        TEST_Convert();
+    }
+    TEST_CHECK(TEST_Drain(&last, 0, UINT32_MAX) == 2);
+
+    //the report holding the gap starts before it, so the next one shows it
+    TEST_CHECK(SAMPLE_DroppedBetween(&before, &last) == (SAMPLE_PACK_SAMPLES_PER_REPORT + TEST_GAP_MAX));
+    ADC_StreamStop();
+}
+
+/*********************************************************************
+* Function: void TEST_GapSaturates(void);
+*
+* Overview: Drops more than streamGapMax conversions in a row.  The tag
+*           saturates, so the timestamps after the gap fall behind by the
+*           excess, while ADC_StreamOverflowCount() still counts every
+*           dropped conversion.
+*
+* PreCondition: none
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+static void TEST_GapSaturates(void)
+{
+    SAMPLE_REPORT last;
+    unsigned int i;
+    const unsigned int dropped = TEST_GAP_MAX + 37;
+
+    TEST_Start(&last);
+
+    for(i = 0; i < TEST_RING_CAPACITY; i++)
+    {
+        TEST_Convert();
+    }
+    TEST_Drop(dropped);
+    TEST_CHECK(ADC_StreamOverflowCount() == dropped);
+
+    TEST_CHECK(TEST_Drain(&last, 0, UINT32_MAX) == (TEST_RING_CAPACITY / SAMPLE_PACK_SAMPLES_PER_REPORT));
+
+    //the report holding the gap still starts before it and is exact, the
+    //ones after it are dropped - TEST_GAP_MAX late
+    for(i = 0; i < SAMPLE_PACK_SAMPLES_PER_REPORT; i++)
+    {
+        TEST_Convert();
+    }
+    TEST_CHECK(TEST_Drain(&last, 0, UINT32_MAX) == 1);
+    for(i = 0; i < (2 * SAMPLE_PACK_SAMPLES_PER_REPORT); i++)
+    {
+        TEST_Convert();
+    }
+    TEST_CHECK(TEST_Drain(&last, dropped - TEST_GAP_MAX, UINT32_MAX) == 2);
+    ADC_StreamStop();
+}
+
+/*********************************************************************
+* Function: void TEST_LateInterrupt(void);
+*
+* Overview: Conversions overwritten before a late interrupt ran are tagged
+*           as a gap like the ones a full ring drops, so every timestamp
+*           stays exact and SAMPLE_DroppedBetween() finds them.
+*
+* PreCondition: none
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+static void TEST_LateInterrupt(void)
+{
+    SAMPLE_REPORT last;
+    SAMPLE_REPORT before;
+    unsigned int i;
+
+    TEST_Start(&last);
+
+    for(i = 0; i < SAMPLE_PACK_SAMPLES_PER_REPORT; i++)
+    {
+        TEST_Convert();
+    }
+    TEST_CHECK(TEST_Drain(&last, 0, UINT32_MAX) == 1);
+    before = last;
+
+    for(i = 0; i < SAMPLE_PACK_SAMPLES_PER_REPORT; i++)
+    {
+        TEST_Convert();
+        if(i == 5)
+        {
+            TEST_Miss(3);
+        }
+    }
+    TEST_Miss(1);
+    for(i = 0; i < SAMPLE_PACK_SAMPLES_PER_REPORT; i++)
+    {
+        TEST_Convert();
+    }
+    TEST_CHECK(TEST_Drain(&last, 0, UINT32_MAX) == 2);
+
+    //the report in between counts as dropped too, see TEST_GapAtMax()
+    TEST_CHECK(SAMPLE_DroppedBetween(&before, &last) == (SAMPLE_PACK_SAMPLES_PER_REPORT + 4));
+    TEST_CHECK(ADC_StreamOverflowCount() == 0);
+    ADC_StreamStop();
+}
+
+/*********************************************************************
+* Function: void TEST_LateInterruptOversampled(void);
+*
+* Overview: With an oversample of 1 (4 conversions per result), a result
+*           missing any of its conversions is dropped as a gap, and so is
+*           every result a longer late run covers, so the timestamp of the
+*           next whole result is still exact.
+*
+* PreCondition: none
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+static void TEST_LateInterruptOversampled(void)
+{
+    SAMPLE_REPORT last;
+    unsigned int i;
+
+    TEST_Start(&last);
+    TEST_CHECK(ADC_StreamStart(ADC_CHANNEL_3, 1) == true);
+
+    //result 0 whole: (0 + 1 + 2 + 3) >> 1
+    for(i = 0; i < 4; i++)
+    {
+        TEST_Convert();
+    }
+    TEST_CHECK(ADC_StreamAvailable() == 1);
+    TEST_CHECK(ADC_StreamRead() == 3);
+    TEST_CHECK(ADC_StreamTimestamp() == 0);
+
+    //result 1 misses its second conversion
+    TEST_Convert();
+    TEST_Miss(1);
+    TEST_Convert();
+    TEST_Convert();
+    TEST_CHECK(ADC_StreamAvailable() == 0);
+
+    //result 2 whole: (8 + 9 + 10 + 11) >> 1
+    for(i = 0; i < 4; i++)
+    {
+        TEST_Convert();
+    }
+    TEST_CHECK(ADC_StreamAvailable() == 1);
+    TEST_CHECK(ADC_StreamRead() == 19);
+    TEST_CHECK(ADC_StreamTimestamp() == 2);
+
+    //the run covers the end of result 3 and all of result 4
+    TEST_Convert();
+    TEST_Convert();
+    TEST_Miss(6);
+    TEST_CHECK(ADC_StreamAvailable() == 0);
+
+    //result 5 whole: (20 + 21 + 22 + 23) >> 1
+    for(i = 0; i < 4; i++)
+    {
+        TEST_Convert();
+    }
+    TEST_CHECK(ADC_StreamAvailable() == 1);
+    TEST_CHECK(ADC_StreamRead() == 43);
+    TEST_CHECK(ADC_StreamTimestamp() == 5);
+    TEST_CHECK(ADC_StreamOverflowCount() == 0);
+    ADC_StreamStop();
+}
+
+/*********************************************************************
+* Function: void TEST_CounterWrap(void);
+*
+* Overview: Streams without drops until the 16-bit timestamp has wrapped
+*           twice (the 8-bit sequence wraps on the way many times), and
+*           checks that no report looks like a drop across the wraps.
+*
+* PreCondition: none
+*
+* Input: None
+*
+* Output: None
+*
+********************************************************************/
+static void TEST_CounterWrap(void)
+{
+    SAMPLE_REPORT last;
+    SAMPLE_REPORT previous;
+    uint32_t reports;
+    unsigned int i;
+
+    TEST_Start(&last);
+    reports = 0;
+
+    while(conversionIndex < (2 * 65536 + 1000))
+    {
+        for(i = 0; i < SAMPLE_PACK_SAMPLES_PER_REPORT; i++)
+        {
+            TEST_Convert();
+        }
+        previous = last;
+        TEST_CHECK(TEST_Drain(&last, 0, UINT32_MAX) == 1);
+        if(reports != 0)
+        {
+            TEST_CHECK(SAMPLE_DroppedBetween(&previous, &last) == 0);
+        }
+        reports++;
+    }
+    TEST_CHECK(reports > 2 * (65536 / SAMPLE_PACK_SAMPLES_PER_REPORT));
+    TEST_CHECK(ADC_StreamOverflowCount() == 0);
+    ADC_StreamStop();
+}
+
+int main(void)
+{
+    TEST_PackAllValues();
+    TEST_GapAtMax();
+    TEST_GapSaturates();
+    TEST_LateInterrupt();
+    TEST_LateInterruptOversampled();
+    TEST_CounterWrap();
+
+    return TEST_Result("test_sample_roundtrip");
+}
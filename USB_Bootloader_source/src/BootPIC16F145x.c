@@ -58,6 +58,7 @@
     #define ERASE_PAGE_SIZE             0x40            //64 byte erase block size (32 words) on the PIC16F145x family devices
     #define ERASE_PAGE_NUM_WORDS        (ERASE_PAGE_SIZE / 2)
     #define ERASE_PAGE_ADDRESS_MASK     0xFFE0          //AND mask to move any flash address back to the start of the erase page
+    #define APP_ROW_COUNT               (((USER_END + 1) - APP_SPACE_START_ADDRESS) / ERASE_PAGE_NUM_WORDS)
 
 #endif
 
@@ -72,6 +73,18 @@
 #define RESET_DEVICE                0x08    //Resets the microcontroller, so it can update the config bits (if they were programmed, and so as to leave the bootloader (and potentially go back into the main application)
 #define SIGN_FLASH                  0x09    //The host PC application should send this command after the verify operation has completed successfully.  If checksums are used instead of a true verify (due to ALLOW_GET_DATA_COMMAND being commented), then the host PC application should send SIGN_FLASH command after is has verified the checksums are as exected. The firmware will then program the SIGNATURE_WORD into flash at the SIGNATURE_ADDRESS.
 #define QUERY_EXTENDED_INFO         0x0C    //Used by host PC app to get additional info about the device, beyond the basic NVM layout provided by the query device command
+#define GET_DATA_STREAM             0x0D    //Like GET_DATA, but for a whole address range: the device keeps sending GET_DATA style packets (with this command byte) until ReadLength bytes have been returned
+#define VERIFY_CRC                  0x0E    //Host sends a start address and length, the device replies with the CRC-16 of that range of the GET_DATA image (see ComputeFlashCrc())
+#define COMPARE_ROWS                0x0F    //Host sends the expected CRC-16 of consecutive rows, the device replies with a bitmap of the rows that differ and can erase just those (differential update)
+#define ERASE_ON_WRITE              0x10    //Alternative to ERASE_DEVICE: only the signature row and User ID are erased now, every other row is erased by WriteFlashBlock() just before it is first written
+#define PROGRAM_DEVICE_RLE          0x11    //Like PROGRAM_DEVICE, but the Data field holds run-length encoded words (see ProgramRlePacket()), decoded on the fly into the ProgrammingBuffer[]
+
+//Run-Length Encoded Program Data Definitions: RLE_RUN_FLAG, RLE_COUNT_MASK in BootRle.inc
+
+//Compare Rows Command Definitions
+#define COMPARE_ROWS_MAX_ROWS           28      //Row CRCs that fit in one packet after the 7 byte header
+#define COMPARE_ROWS_ERASE_DIFFERING    0x01    //RowFlags: erase the rows that differ (and the signature row)
+#define COMPARE_ROWS_SIGNATURE_ERASED   0x80    //RowFlags in the response: the signature row was erased, SIGN_FLASH is needed again
 
 //Unlock Configs Command Definitions
 #define UNLOCKCONFIG                0x00    //Sub-command for the ERASE_DEVICE command
@@ -101,6 +114,18 @@
 #define REQUEST_DATA_BLOCK_SIZE     0x3A    //Number of data bytes in a standard request to the PC.  Must be an even number from 2-58 (0x02-0x3A).  Larger numbers make better use of USB bandwidth and 
                                             //yeild shorter program/verify times, but require more micrcontroller RAM for buffer space.
 #define BLANK_FLASH_WORD_VALUE      0x3FFF
+#define CRC16_POLYNOMIAL            0x1021
+#define CRC16_INITIAL_VALUE         0xFFFF
+
+//Helpers shared by the optional commands (see usb_config.h).  They are only
+//built when a command needs them, the default build keeps the original
+//inline code so that its size does not change.
+#if defined(ENABLE_GET_DATA_STREAM_COMMAND) || defined(ENABLE_VERIFY_CRC_COMMAND) || defined(ENABLE_COMPARE_ROWS_COMMAND)
+    #define USE_READ_FLASH_WORD
+#endif
+#if defined(ENABLE_ERASE_ON_WRITE_COMMAND) || defined(ENABLE_COMPARE_ROWS_COMMAND)
+    #define USE_ERASE_ROW
+#endif
 
 /** USB Packet Request/Response Formatting Structure **********************************************************/
 typedef union 
@@ -151,6 +176,39 @@ typedef union
         unsigned char LockValue;
     };
 
+    //For the COMPARE_ROWS command.  RowCrc[n] is the CRC-16 (as VERIFY_CRC
+    //computes it) the host expects for the 64 byte row at RowAddress + 64 * n.
+    struct
+    {
+        unsigned char Command;
+        unsigned long RowAddress;   //Byte address of the first row, row aligned
+        unsigned char RowCount;     //1 to COMPARE_ROWS_MAX_ROWS
+        unsigned char RowFlags;
+        unsigned int RowCrc[COMPARE_ROWS_MAX_ROWS];
+    };
+
+    //COMPARE_ROWS response: the request header echoed, then bit n of
+    //RowDiffers set if row n differs from its expected CRC.
+    struct
+    {
+        unsigned char Command;
+        unsigned long RowAddress;
+        unsigned char RowCount;
+        unsigned char RowFlags;
+        unsigned long RowDiffers;
+    };
+
+    //For the GET_DATA_STREAM command.  Both fields are advanced in place as
+    //the response packets are sent.  VERIFY_CRC uses the same request, and
+    //its response echoes both fields and adds the Crc.
+    struct
+    {
+        unsigned char Command;
+        unsigned long ReadAddress;  //Byte address, as used by GET_DATA
+        unsigned int ReadLength;    //Number of bytes still to send
+        unsigned int Crc;
+    };
+
     //Structure for the QUERY_EXTENDED_INFO command (and response)
     struct{
         unsigned char Command;
@@ -185,6 +243,10 @@ unsigned char BufferedDataIndex;
 unsigned int  ProgrammedPointer;
 unsigned char ConfigsLockValue;
 unsigned char ProgrammingBuffer[WRITE_BLOCK_SIZE];
+#if defined(ENABLE_ERASE_ON_WRITE_COMMAND)
+unsigned char EraseOnWrite;                         //TRUE after ERASE_ON_WRITE, until the next ERASE_DEVICE
+unsigned char ErasedRows[(APP_ROW_COUNT + 7) / 8];  //One bit per application row, set once the row has been erased in that mode
+#endif
 
 PacketToFromPC PacketFromPC;
 PacketToFromPC PacketToPC;
@@ -199,6 +261,25 @@ void UnlockAndActivate(unsigned char UnlockKey);
 void ResetDeviceCleanly(void);
 void SignFlash(void);
 void LowVoltageCheck(void);
+#if defined(USE_READ_FLASH_WORD)
+unsigned int ReadFlashWord(unsigned long Address);
+#endif
+#if defined(ENABLE_GET_DATA_STREAM_COMMAND)
+void ReadFlashToPacket(unsigned long Address, unsigned char Size);
+#endif
+#if defined(ENABLE_VERIFY_CRC_COMMAND) || defined(ENABLE_COMPARE_ROWS_COMMAND)
+unsigned int ComputeFlashCrc(unsigned long Address, unsigned int Length);
+#endif
+#if defined(ENABLE_COMPARE_ROWS_COMMAND)
+void CompareRows(void);
+#endif
+#if defined(ENABLE_PROGRAM_DEVICE_RLE_COMMAND)
+void BufferProgramByte(unsigned char Byte);
+void ProgramRlePacket(void);
+#endif
+#if defined(USE_ERASE_ROW)
+void EraseRow(unsigned int Addr);
+#endif
 
 
 /** D E C L A R A T I O N S **************************************************/
@@ -210,6 +291,9 @@ void UserInit(void)
     ProgrammedPointer = INVALID_ADDRESS;
     BufferedDataIndex = 0;
     ConfigsLockValue = TRUE;
+    #if defined(ENABLE_ERASE_ON_WRITE_COMMAND)
+        EraseOnWrite = FALSE;
+    #endif
 
 }//end UserInit
 
@@ -236,7 +320,9 @@ void UserInit(void)
 void ProcessIO(void)
 {
     unsigned char i;
+    #if !defined(ENABLE_GET_DATA_STREAM_COMMAND)
     unsigned long int TmpAddr;
+    #endif
 
     //Checks for and processes application related USB packets (assuming the
     //USB bus is in the CONFIGURED_STATE, which is the only state where
@@ -320,11 +406,15 @@ void ProcessIO(void)
                 //First erase main program flash memory
                 for(ErasePageTracker = APP_SPACE_START_ADDRESS; ErasePageTracker < USER_END; ErasePageTracker += ERASE_PAGE_NUM_WORDS)
                 {
+                    #if defined(USE_ERASE_ROW)
+                    EraseRow(ErasePageTracker);
+                    #else
                     ClrWdt();
                     PMADR = ErasePageTracker;
                     CFGS = 0;  // Access FLASH space not CONFIG
                     FREE = 1;  // Perform erase on next WR command, cleared by HW
                     UnlockAndActivate(CORRECT_UNLOCK_KEY);
+                    #endif
                 }
                 
                 //Now erase the User ID space (0x8000 to 0x8008)
@@ -333,9 +423,36 @@ void ProcessIO(void)
                 FREE = 1;
                 UnlockAndActivate(CORRECT_UNLOCK_KEY);
 
+                #if defined(ENABLE_ERASE_ON_WRITE_COMMAND)
+                    EraseOnWrite = FALSE;
+                #endif
                 BootState = IDLE;               
                 break;
 
+            #if defined(ENABLE_ERASE_ON_WRITE_COMMAND)
+            case ERASE_ON_WRITE:
+                //Erase the signature row up front, so that an interrupted
+                //update is never run, and the User ID space.  The rest of the
+                //application space is left to WriteFlashBlock(), which then
+                //overlaps each row erase with the USB transfer of the next
+                //packets and never touches rows the new image does not use.
+                for(i = 0; i < sizeof(ErasedRows); i++)
+                {
+                    ErasedRows[i] = 0;
+                }
+                EraseRow(APP_SIGNATURE_ADDRESS);
+                ErasedRows[0] = 0x01;   //The signature row is the first application row
+
+                PMADR = 0;
+                CFGS = 1;   // Config space
+                FREE = 1;
+                UnlockAndActivate(CORRECT_UNLOCK_KEY);
+
+                EraseOnWrite = TRUE;
+                BootState = IDLE;
+                break;
+            #endif
+
             case PROGRAM_DEVICE:
                 //Check if host is trying to program the User ID bytes (or config bits, which are at an even higher address)
                 if(PacketFromPC.Address >= USER_ID_ADDRESS)
@@ -366,6 +483,9 @@ void ProcessIO(void)
                 {
                     for(i = 0; i < PacketFromPC.Size; i++)
                     {
+                        #if defined(ENABLE_PROGRAM_DEVICE_RLE_COMMAND)
+                        BufferProgramByte(PacketFromPC.Data[i+(REQUEST_DATA_BLOCK_SIZE-PacketFromPC.Size)]);    //Data field is right justified.  Need to put it in the buffer left justified.
+                        #else
                         ProgrammingBuffer[BufferedDataIndex] = PacketFromPC.Data[i+(REQUEST_DATA_BLOCK_SIZE-PacketFromPC.Size)];    //Data field is right justified.  Need to put it in the buffer left justified.
                         BufferedDataIndex++;
                         ProgrammedPointer++;
@@ -373,6 +493,7 @@ void ProcessIO(void)
                         {
                             WriteFlashBlock();
                         }
+                        #endif
                     }
                 }
                 //else host sent us a non-contiguous packet address...  to make 
@@ -381,6 +502,25 @@ void ProcessIO(void)
                 BootState = IDLE;
                 break;
 
+            #if defined(ENABLE_PROGRAM_DEVICE_RLE_COMMAND)
+            case PROGRAM_DEVICE_RLE:
+                //Same addressing rules as PROGRAM_DEVICE, for program memory
+                //only (the User ID and config bits still go through PROGRAM_DEVICE).
+                //Address is the byte address of the first decoded byte.
+                if(PacketFromPC.Address < USER_ID_ADDRESS)
+                {
+                    if(ProgrammedPointer == (unsigned int)INVALID_ADDRESS)
+                        ProgrammedPointer = PacketFromPC.Address;
+
+                    if(ProgrammedPointer == (unsigned int)PacketFromPC.Address)
+                    {
+                        ProgramRlePacket();
+                    }
+                }
+                BootState = IDLE;
+                break;
+            #endif
+
             case PROGRAM_COMPLETE:
                 WriteFlashBlock();
                 ProgrammedPointer = INVALID_ADDRESS;        //Reinitialize pointer to an invalid range, so we know the next PROGRAM_DEVICE will be the start address of a contiguous section.
@@ -393,6 +533,9 @@ void ProcessIO(void)
                 {
                     //Init pad bytes to 0x00...  Already done after we received the QUERY_DEVICE command (just after calling HIDRxReport()).
                     PacketToPC.Command = GET_DATA;
+                    #if defined(ENABLE_GET_DATA_STREAM_COMMAND)
+                    ReadFlashToPacket(PacketFromPC.Address, PacketFromPC.Size);
+                    #else
                     PacketToPC.Address = PacketFromPC.Address;
                     PacketToPC.Size = PacketFromPC.Size;
 
@@ -439,6 +582,7 @@ void ProcessIO(void)
                         }
                         PMADR++; // Next address
                     }//for(i = 0; i < PacketFromPC.Size; i++)
+                    #endif
 
                     //Now arm the USB IN endpoint to send the packet to the host.
                     HIDTxReport((char *)&PacketToPC, USB_PACKET_SIZE);
@@ -446,6 +590,66 @@ void ProcessIO(void)
                 }//if(!HIDTxHandleBusy(USBInHandle)) //if(!mHIDTxIsBusy())
                 break;
 
+            #if defined(ENABLE_GET_DATA_STREAM_COMMAND)
+            case GET_DATA_STREAM:
+                //Send the next packet of the range each time the IN endpoint
+                //frees up, staying NOT_IDLE until the whole range has gone out.
+                //The host reads the packets back-to-back, without a request
+                //for each of them.
+                if(!mHIDTxIsBusy())
+                {
+                    if(PacketFromPC.ReadLength == 0)
+                    {
+                        BootState = IDLE;
+                        break;
+                    }
+
+                    i = REQUEST_DATA_BLOCK_SIZE;
+                    if(PacketFromPC.ReadLength < REQUEST_DATA_BLOCK_SIZE)
+                    {
+                        i = (unsigned char)PacketFromPC.ReadLength;
+                    }
+
+                    PacketToPC.Command = GET_DATA_STREAM;
+                    ReadFlashToPacket(PacketFromPC.ReadAddress, i);
+                    HIDTxReport((char *)&PacketToPC, USB_PACKET_SIZE);
+
+                    PacketFromPC.ReadAddress += i;
+                    PacketFromPC.ReadLength -= i;
+                    if(PacketFromPC.ReadLength == 0)
+                    {
+                        BootState = IDLE;
+                    }
+                }
+                break;
+            #endif
+
+            #if defined(ENABLE_COMPARE_ROWS_COMMAND)
+            case COMPARE_ROWS:
+                if(!mHIDTxIsBusy())
+                {
+                    CompareRows();
+                    HIDTxReport((char *)&PacketToPC, USB_PACKET_SIZE);
+                    BootState = IDLE;
+                }
+                break;
+            #endif
+
+            #if defined(ENABLE_VERIFY_CRC_COMMAND)
+            case VERIFY_CRC:
+                if(!mHIDTxIsBusy())
+                {
+                    //Pad bytes already cleared just after calling HIDRxReport()
+                    PacketToPC.Command = VERIFY_CRC;
+                    PacketToPC.ReadAddress = PacketFromPC.ReadAddress;
+                    PacketToPC.ReadLength = PacketFromPC.ReadLength;
+                    PacketToPC.Crc = ComputeFlashCrc(PacketFromPC.ReadAddress, PacketFromPC.ReadLength);
+                    HIDTxReport((char *)&PacketToPC, USB_PACKET_SIZE);
+                    BootState = IDLE;
+                }
+                break;
+            #endif
+
             case SIGN_FLASH:
                 SignFlash();
                 BootState = IDLE;
@@ -497,6 +701,202 @@ void ProcessIO(void)
 }//End ProcessIO()
 
 
+#if defined(USE_READ_FLASH_WORD)
+//Reads the program memory word holding the byte address Address, as the
+//host sees it in the .hex image: a blank word (0x3FFF) is returned as 0xFFFF,
+//since the PC GUI app is assuming a PIC18 style device where all blank bytes
+//will read as 0xFF, when performing the verify comparison.
+unsigned int ReadFlashWord(unsigned long Address)
+{
+    unsigned long int TmpAddr;
+
+    TmpAddr = ((uint32_t)Address / 2);
+    PMADR = TmpAddr;
+
+    if(TmpAddr >= CONFIG_WORDS_START_ADDRESS)
+    {
+        PMCON1bits.CFGS = 1;   // Read from config not Flash
+        PMADRH=0;
+    }
+    else
+    {
+        PMCON1bits.CFGS = 0;   // Read from Flash not config
+    }
+
+    PMCON1bits.RD = 1;     // Initiate Read
+    NOP();               // Two instruction delay in read
+    NOP();
+
+    //Check if the read 14-bit WORD from flash is blank or not (0x3FFF is blank value)
+    if(PMDAT == BLANK_FLASH_WORD_VALUE)
+    {
+        return 0xFFFF;  // Faked return
+    }
+    return PMDAT;       // regular return
+}
+#endif
+
+
+#if defined(ENABLE_GET_DATA_STREAM_COMMAND)
+//Fills the Address, Size and Data fields of PacketToPC the way GET_DATA
+//returns them: Size bytes read from the byte address Address, right justified
+//in Data[].  The leading pad bytes are not cleared again: ProcessIO() clears
+//the whole packet when the command arrives, and the host only reads the last
+//Size bytes of the later GET_DATA_STREAM packets.
+void ReadFlashToPacket(unsigned long Address, unsigned char Size)
+{
+    static unsigned char i;
+    unsigned int Word;
+
+    PacketToPC.Address = Address;
+    PacketToPC.Size = Size;
+
+    //Read every byte of flash memory that the PC app is requesting
+    for(i = 0; i < Size; i++)
+    {
+        Word = ReadFlashWord(Address);
+
+        PacketToPC.Data[i+((USB_PACKET_SIZE - 6) - Size)] = (unsigned char)Word;  // Low byte first in the data
+        i++;
+
+        //Check if we should exit from for() loop early, in case PC
+        //GUI app is requesting an odd number of bytes from the device.
+        if(i >= Size)
+            break;
+
+        PacketToPC.Data[i+((USB_PACKET_SIZE - 6) - Size)] = (unsigned char)(Word >> 8);
+        Address += 2; // Next address
+    }//for(i = 0; i < Size; i++)
+}
+#endif
+
+
+#if defined(ENABLE_VERIFY_CRC_COMMAND) || defined(ENABLE_COMPARE_ROWS_COMMAND)
+//Computes the VERIFY_CRC checksum: CRC-16/CCITT-FALSE (polynomial 0x1021,
+//initial value 0xFFFF, no reflection, no final XOR) over Length bytes of the
+//GET_DATA image starting at the byte address Address.  Bitwise rather than
+//table driven, to keep it small in the bootloader.
+unsigned int ComputeFlashCrc(unsigned long Address, unsigned int Length)
+{
+    static unsigned char j;
+    unsigned int Crc;
+    unsigned int Word;
+
+    Crc = CRC16_INITIAL_VALUE;
+    while(Length != 0)
+    {
+        ClrWdt();
+        Word = ReadFlashWord(Address);
+        if(Address & 1)
+        {
+            Word >>= 8;
+        }
+
+        Crc ^= (Word << 8);
+        for(j = 0; j < 8; j++)
+        {
+            if(Crc & 0x8000)
+            {
+                Crc = (Crc << 1) ^ CRC16_POLYNOMIAL;
+            }
+            else
+            {
+                Crc <<= 1;
+            }
+        }
+
+        Address++;
+        Length--;
+    }
+    return Crc;
+}
+#endif
+
+
+#if defined(ENABLE_PROGRAM_DEVICE_RLE_COMMAND)
+//BufferProgramByte() and ProgramRlePacket(), kept apart for the host test
+#include "BootRle.inc"
+#endif
+
+
+#if defined(ENABLE_COMPARE_ROWS_COMMAND)
+//Handles COMPARE_ROWS: checks every row of the request against its expected
+//CRC and builds the response in PacketToPC.  With COMPARE_ROWS_ERASE_DIFFERING
+//the rows that differ are erased, so the host only has to program those rows
+//(with PROGRAM_DEVICE/PROGRAM_COMPLETE) instead of erasing and reprogramming
+//the whole application.  Before any row is erased the signature row is erased
+//first, so an update interrupted part way leaves an unsigned application that
+//the bootloader will not run.  The host must then reprogram the signature row
+//and send SIGN_FLASH, as after ERASE_DEVICE.  Rows outside the application
+//space are reported but never erased.
+void CompareRows(void)
+{
+    static unsigned char i;
+    unsigned long Address;
+    unsigned long Bit;
+    unsigned int Addr;
+
+    PacketToPC.Command = COMPARE_ROWS;
+    PacketToPC.RowAddress = PacketFromPC.RowAddress;
+    PacketToPC.RowCount = PacketFromPC.RowCount;
+    PacketToPC.RowFlags = PacketFromPC.RowFlags;
+    PacketToPC.RowDiffers = 0;
+
+    if(PacketFromPC.RowCount > COMPARE_ROWS_MAX_ROWS)
+    {
+        PacketToPC.RowCount = COMPARE_ROWS_MAX_ROWS;
+    }
+
+    Address = PacketFromPC.RowAddress;
+    Bit = 1;
+    for(i = 0; i < PacketToPC.RowCount; i++)
+    {
+        if(ComputeFlashCrc(Address, ERASE_PAGE_SIZE) != PacketFromPC.RowCrc[i])
+        {
+            PacketToPC.RowDiffers |= Bit;
+        }
+        Address += ERASE_PAGE_SIZE;
+        Bit <<= 1;
+    }
+
+    if(((PacketFromPC.RowFlags & COMPARE_ROWS_ERASE_DIFFERING) == 0) || (PacketToPC.RowDiffers == 0))
+    {
+        return;
+    }
+
+    EraseRow(APP_SIGNATURE_ADDRESS & ERASE_PAGE_ADDRESS_MASK);
+    PacketToPC.RowFlags |= COMPARE_ROWS_SIGNATURE_ERASED;
+
+    Address = PacketFromPC.RowAddress;
+    Bit = 1;
+    for(i = 0; i < PacketToPC.RowCount; i++)
+    {
+        Addr = (unsigned int)(Address >> 1);    //Convert byte address to 14-bit word address
+        if((PacketToPC.RowDiffers & Bit) && (Addr >= APP_SPACE_START_ADDRESS) && (Addr <= USER_END)
+            && ((Addr & ERASE_PAGE_ADDRESS_MASK) != (APP_SIGNATURE_ADDRESS & ERASE_PAGE_ADDRESS_MASK)))
+        {
+            EraseRow(Addr);
+        }
+        Address += ERASE_PAGE_SIZE;
+        Bit <<= 1;
+    }
+}
+#endif
+
+
+#if defined(USE_ERASE_ROW)
+//Erases the 32 word row holding the program memory word address Addr.
+void EraseRow(unsigned int Addr)
+{
+    ClrWdt();
+    PMADR = Addr;
+    CFGS = 0;  // Access FLASH space not CONFIG
+    FREE = 1;  // Perform erase on next WR command, cleared by HW
+    UnlockAndActivate(CORRECT_UNLOCK_KEY);
+}
+#endif
+
+
 //Should be called once, only after the regular erase/program/verify sequence 
 //has completed successfully.  This function will program the magic
 //APP_SIGNATURE_VALUE into the magic APP_SIGNATURE_ADDRESS in the application
@@ -528,11 +928,15 @@ void SignFlash(void)
     ProgrammingBuffer[((APP_SIGNATURE_ADDRESS & ~ERASE_PAGE_ADDRESS_MASK) * 2) + 1] = 0x34;   //RETLW opcode = 0x34XX (where XX is the WREG literal value returned)
 
     //Now erase the flash memory block with the signature WORD in it
+    #if defined(USE_ERASE_ROW)
+    EraseRow(APP_SIGNATURE_ADDRESS);
+    #else
     ClrWdt();
     PMADR = APP_SIGNATURE_ADDRESS;
     CFGS = 0;  // Access FLASH space not CONFIG
     FREE = 1;  // Perform erase on next WR command, cleared by HW
     UnlockAndActivate(CORRECT_UNLOCK_KEY);
+    #endif
 
     //Now re-program the values from the RAM buffer into the flash memory.  Use
     //reverse order, so we program the larger addresses first.  This way, the
@@ -628,6 +1032,21 @@ void WriteFlashBlock(void)      //Use to write blocks of data to flash.
     CorrectionFactor = (PMADRL & 0b00011111);   //Correctionfactor = number of WORDS tblptr must go back to find the immediate preceeding 64 byte boundary
     PMADRL &= 0b11100000;           //Move the table pointer back to the immediately preceeding 32 WORD boundary
 
+    //After ERASE_ON_WRITE, erase the row just before its first write
+    #if defined(ENABLE_ERASE_ON_WRITE_COMMAND)
+    if(EraseOnWrite == TRUE)
+    {
+        Addr = PMADR;
+        i = (unsigned char)((Addr - APP_SPACE_START_ADDRESS) / ERASE_PAGE_NUM_WORDS);
+        if((ErasedRows[i >> 3] & (1 << (i & 0x07))) == 0)
+        {
+            ErasedRows[i >> 3] |= (1 << (i & 0x07));
+            EraseRow(Addr);
+            PMADR = Addr;
+        }
+    }
+    #endif
+
     for(i = 0; i < (WRITE_BLOCK_SIZE / 2); i++) //Load the programming latches
     {
         CFGS = 0;   // Access Prog not config
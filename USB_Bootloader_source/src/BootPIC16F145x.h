@@ -52,6 +52,25 @@ void DisableUSBandExecuteLongDelay(void);
 #define APP_SIGNATURE_VALUE              0x6D   //0x6D = "GOOD", implying that the erase/program was a success and the bootloader intentionally programmed the APP_SIGNATURE_ADDRESS with this value
 #define APP_VERSION_ADDRESS              0x902 //0x902  //0x902 + 0x903 should contain the application image firmware version number [Major(8bit).Minor(8-bit)]
 
+/* Warm reset request.  Two bytes of RAM at a fixed address, kept across any
+ * reset other than power on/brown out, which the application can set just
+ * before resetting the device (ex: with the RESET instruction or the WDT):
+ *   BOOT_REQUEST_ADDRESS     - request value
+ *   BOOT_REQUEST_ADDRESS + 1 - its complement, the request is ignored otherwise
+ * With BOOT_REQUEST_FAST_BOOT the bootloader skips the sw2 settle delay, the
+ * pin check and the signature reads (the application ran, so it is intact)
+ * and jumps straight into the application.  With BOOT_REQUEST_ENTER_BOOTLOADER
+ * it stays in bootloader mode, as if sw2 was held.  The request is consumed by the
+ * next boot.  Both bytes are the last two of the linear RAM (0x23EE/0x23EF),
+ * which the application project must keep out of its RAM ranges.  Only built
+ * with ENABLE_WARM_RESET_REQUEST (usb_config.h), otherwise requests are ignored
+ * and the application enters the bootloader through BootMain() at 0x001C.
+ */
+#define BOOT_REQUEST_ADDRESS             0x64E  //Bank 12, linear 0x23EE
+#define BOOT_REQUEST_NONE                0x00
+#define BOOT_REQUEST_FAST_BOOT           0xA5
+#define BOOT_REQUEST_ENTER_BOOTLOADER    0x5A
+
 //Derived constants
 #define APP_SPACE_START_HI_BYTE                 (APP_SPACE_RESET_VECTOR >> 8)
 #define APP_SPACE_START_LOWER_11BITS            (APP_SPACE_RESET_VECTOR & 0x7FF)
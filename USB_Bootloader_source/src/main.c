@@ -174,6 +174,13 @@ const unsigned char FlashSignatureWord @APP_SIGNATURE_ADDRESS = APP_SIGNATURE_VA
 uint16_t uint_delay_counter;
 uint8_t DummyVar;
 
+#if defined(ENABLE_WARM_RESET_REQUEST)   //See usb_config.h
+//Warm reset request left by the application, see BOOT_REQUEST_ADDRESS.  Not
+//cleared by the C startup code.
+persistent uint8_t BootRequest @ BOOT_REQUEST_ADDRESS;
+persistent uint8_t BootRequestCheck @ (BOOT_REQUEST_ADDRESS + 1);
+#endif
+
 
 //------------------------------------------------------------------------------
 //Interrupt vector remapping code
@@ -215,7 +222,40 @@ void interrupt ISRCode()
  *****************************************************************************/
 void main(void)
 {
-    unsigned int i;
+#if defined(ENABLE_WARM_RESET_REQUEST)   //See usb_config.h
+    uint8_t Request;
+
+    //Take the warm reset request, if the application left a valid one.  RAM
+    //holds garbage after a power on or brown out reset, so only trust it when
+    //neither happened.  The request is consumed here, so a later reset that
+    //the application did not ask for boots normally.
+    Request = BOOT_REQUEST_NONE;
+    if((PCONbits.nPOR == 1) && (PCONbits.nBOR == 1) && (BootRequest == (uint8_t)~BootRequestCheck))
+    {
+        Request = BootRequest;
+    }
+    BootRequest = BOOT_REQUEST_NONE;
+    BootRequestCheck = BOOT_REQUEST_NONE;
+    PCONbits.nPOR = 1;
+    PCONbits.nBOR = 1;
+
+    if(Request == BOOT_REQUEST_FAST_BOOT)
+    {
+        //The application was running just before this reset, so it is intact
+        //and signed.  Skip the sw2 check and the signature reads.
+        #asm
+            movlp APP_SPACE_START_HI_BYTE
+            goto APP_SPACE_START_LOWER_11BITS
+        #endasm
+    }
+
+    if(Request == BOOT_REQUEST_ENTER_BOOTLOADER)
+    {
+        //The application asked for a firmware update (soft entry, it has
+        //already detached from the host for long enough).
+        BootMain();
+    }
+#endif
 
     //Note: If you disable MLCR (so it gets used as RA3 general purpose input)
     //and then use RA3 as the bootloader entry check I/O pin, it is recommended
@@ -227,14 +267,11 @@ void main(void)
     //the proper value.  This is also possible immediately after exiting ICSP programming
     //mode, as it may take some time for the programmer to tri-state the MCLR/RA3
     //pin and for the pull up resistor to overcome any capacitance on the pin.
-    for(i = 0; i < 1000; i++);    //Make sure this delay is long enough for the sw2 pin can
-                                //fully settle to the correct value based on the PCB circuit,
-                                //prior to doing the I/O pin bootloader entry check.
-
-    
     //Perform startup check of I/O pin to see if we should stay in bootloader
     //mode (ex: because the user is pressing the pushbutton on the board)
     #if defined(ENABLE_IO_PIN_CHECK_BOOTLOADER_ENTRY)   //See usb_config.h
+        _delay(SW2_SETTLE_TIME_US / 8);     //Make sure the sw2 pin has fully settled to the correct value based
+                                            //on the PCB circuit (8us per instruction cycle at the reset clock)
         mInitSwitch2();
         if(sw2 == 0)
         {
@@ -318,6 +355,13 @@ void __at(BOOTLOADER_ABSOLUTE_ENTRY_ADDRESS) BootMain(void)
     //bootloader mode with excessive junk on the call stack
     STKPTR = 0x00;  
 
+    #if defined(ENABLE_WARM_RESET_REQUEST)
+        //A software entry from the application bypasses main(), so make sure no
+        //fast boot request survives into the reset that ends this session.
+        BootRequest = BOOT_REQUEST_NONE;
+        BootRequestCheck = BOOT_REQUEST_NONE;
+    #endif
+
     //End of the important parts of the C initializer.  This bootloader firmware does not use
     //any C initialized user variables (idata memory sections).  Therefore, the above is all
     //the initialization that is normally required.
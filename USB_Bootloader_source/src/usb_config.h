@@ -36,6 +36,36 @@ please contact mla_licensing@microchip.com
 #define ENABLE_IO_PIN_CHECK_BOOTLOADER_ENTRY  //Uncomment if you wish to enable I/O pin entry method into bootloader mode
                                               //Make sure proper sw2() macro definition is provided in HardwareProfile.h
 
+//Time given to the sw2 pin to settle after reset, before it is checked.  This
+//runs on the 500kHz reset default INTOSC (8us per instruction cycle) and is
+//timed with _delay(), so it does not depend on how the compiler builds a loop.
+//It must cover the rise time of the pin: the pull up charging the PCB and
+//switch capacitance, or the programmer releasing MCLR/RA3 after ICSP.
+//5ms is a conservative estimate, not a measurement.  Even at the minimum RA3
+//weak pull up current (25uA) a generous 1nF on the pin (a switch and a trace
+//are nearer 100pF) charges to the 0.8*VDD input high level in about 0.2ms at
+//5V, so 5ms leaves more than 20 times that.  The old 1000 iteration loop was
+//not sized for the pin: it took an estimated 65-80ms at this clock (depending
+//on the code XC8 generated), which was mostly wasted boot time.  Increase
+//this if a board has a slower (RC filtered) sw2 or a programmer that
+//releases the pin late.
+#define SW2_SETTLE_TIME_US      5000
+
+//Optional bootloader commands and boot paths.  The default build only has
+//room for about two dozen more instruction words below APP_SPACE_START_ADDRESS
+//(0x900), and each of these options adds more code than that.  Enabling one of
+//them therefore needs a bootloader built and checked with XC8 PRO (see the
+//notes at the top of main.c), and usually a larger bootloader region: move
+//APP_SPACE_START_ADDRESS/APP_SPACE_RESET_VECTOR up in BootPIC16F145x.h and
+//relink every application project to match.  Leave them commented out unless
+//the host tools actually use them.
+//#define ENABLE_GET_DATA_STREAM_COMMAND    //GET_DATA_STREAM (0x0D): bulk read back of an address range
+//#define ENABLE_VERIFY_CRC_COMMAND         //VERIFY_CRC (0x0E): CRC-16 of an address range, computed on the device
+//#define ENABLE_COMPARE_ROWS_COMMAND       //COMPARE_ROWS (0x0F): per row CRC compare, with optional erase of the rows that differ
+//#define ENABLE_ERASE_ON_WRITE_COMMAND     //ERASE_ON_WRITE (0x10): rows are erased just before they are first written
+//#define ENABLE_PROGRAM_DEVICE_RLE_COMMAND //PROGRAM_DEVICE_RLE (0x11): run-length encoded program data
+//#define ENABLE_WARM_RESET_REQUEST         //Fast boot/enter bootloader requests left in RAM by the application, see BOOT_REQUEST_ADDRESS
+
 //Option to allow blinking of LED to show USB bus status.  May be optionally
 //commented out to save code space (and/or if there are no LEDs available on
 //the actual target application board).  If this option is uncommented, you must